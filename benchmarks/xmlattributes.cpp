@@ -0,0 +1,238 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "xmlutilities.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLineF>
+#include <QStringList>
+#include <QTextStream>
+#include <QTransform>
+
+/*!
+ * \file
+ * \brief Compares the XmlReader attribute parsers with the previous code.
+ *
+ * The previous readPointAttribute(), readLineAttribute() and
+ * readTransformAttribute() converted every attribute to a QString and split
+ * it into a QStringList. They are kept here as the baseline for the current
+ * implementation, which tokenizes the attribute values in place.
+ *
+ * A document with N items, each one with a point, a line and a transform
+ * attribute, is read three times: once only tokenizing the xml (to measure
+ * the cost shared by both parsers), once with the old parsers and once with
+ * the new ones. Each pass is repeated and the best time is reported.
+ *
+ * Usage: caneda-xmlbenchmark [N], where N defaults to 100000.
+ */
+
+namespace
+{
+    //! \brief Number of times each pass is repeated.
+    const int Repetitions = 5;
+
+    //! \brief Which attribute parsers to use in a pass.
+    enum Pass {TokenizeOnly, OldParsers, NewParsers};
+
+    //! \brief Previous implementation of XmlReader::readPointAttribute().
+    QPointF oldReadPointAttribute(QXmlStreamReader *reader, QString tag)
+    {
+        QString pointStr = reader->attributes().value(tag).toString();
+        int commaPos = pointStr.indexOf(',');
+
+        QPointF point;
+        bool ok;
+        point.setX(pointStr.left(commaPos).toDouble(&ok));
+        point.setY(pointStr.mid(commaPos+1).toDouble(&ok));
+
+        return point;
+    }
+
+    //! \brief Previous implementation of XmlReader::readLineAttribute().
+    QLineF oldReadLineAttribute(QXmlStreamReader *reader, QString tag)
+    {
+        QString errorString = QObject::tr("Invalid line attribute");
+        QStringList lineCoordsStr = reader->attributes().value(tag).toString().
+            split(",",Qt::SkipEmptyParts);
+
+        if(lineCoordsStr.size() != 4) {
+            reader->raiseError(errorString);
+            return QLineF();
+        }
+
+        qreal lineCoords[4];
+        bool ok;
+        for(int i=0; i < 4; ++i) {
+            lineCoords[i] = lineCoordsStr.at(i).trimmed().toDouble(&ok);
+            if(!ok) {
+                reader->raiseError(errorString);
+                return QLineF();
+            }
+        }
+
+        return QLineF(lineCoords[0], lineCoords[1], lineCoords[2], lineCoords[3]);
+    }
+
+    //! \brief Previous implementation of XmlReader::readTransformAttribute().
+    QTransform oldReadTransformAttribute(QXmlStreamReader *reader, QString tag)
+    {
+        QString errorString = QObject::tr("Invalid transform matrix");
+        QStringList eleStr = reader->attributes().value(tag).toString().split(',');
+
+        if(eleStr.size() != 6) {
+            reader->raiseError(errorString);
+            return QTransform();
+        }
+
+        bool ok, finalOk = true;
+        qreal ele[6];
+        for(int i = 0; i < 6; ++i) {
+            ele[i] = eleStr[i].toDouble(&ok);
+            finalOk = finalOk && ok;
+        }
+
+        if(!finalOk) {
+            reader->raiseError(errorString);
+            return QTransform();
+        }
+
+        QTransform transformMatrix
+            (ele[0], ele[2], ele[4],
+             ele[1], ele[3], ele[5],
+             0,      0,          1);
+
+        return transformMatrix.inverted();
+    }
+
+    //! \brief Returns a document with \a count items to parse.
+    QByteArray createDocument(int count)
+    {
+        QByteArray data;
+        QTextStream stream(&data);
+
+        stream << "<items>\n";
+        for(int i = 0; i < count; ++i) {
+            qreal x = (i % 1000) * 10.0;
+            qreal y = (i / 1000) * 10.0;
+            stream << "<item point=\"" << x << "," << y << "\""
+                   << " line=\"0,0," << x + 12.5 << "," << y - 7.25 << "\""
+                   << " transform=\"1,0,0,1," << x << "," << y << "\"/>\n";
+        }
+        stream << "</items>\n";
+        stream.flush();
+
+        return data;
+    }
+
+    /*!
+     * \brief Reads \a data with the parsers of \a pass.
+     *
+     * \param checksum Sum of all parsed values, used to check that both
+     * parsers return the same results (and to keep the calls from being
+     * optimized away).
+     * \return Elapsed time in nanoseconds.
+     */
+    qint64 run(const QByteArray &data, Pass pass, qreal *checksum)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        Caneda::XmlReader reader(data);
+        qreal sum = 0;
+
+        while(!reader.atEnd()) {
+            reader.readNext();
+            if(!reader.isStartElement() || reader.name() != QLatin1String("item")) {
+                continue;
+            }
+
+            QPointF point;
+            QLineF line;
+            QTransform transform;
+
+            if(pass == OldParsers) {
+                point = oldReadPointAttribute(&reader, "point");
+                line = oldReadLineAttribute(&reader, "line");
+                transform = oldReadTransformAttribute(&reader, "transform");
+            }
+            else if(pass == NewParsers) {
+                point = reader.readPointAttribute("point");
+                line = reader.readLineAttribute("line");
+                transform = reader.readTransformAttribute("transform");
+            }
+
+            sum += point.x() + point.y() + line.x2() + line.y2() +
+                    transform.dx() + transform.dy();
+        }
+
+        qint64 elapsed = timer.nsecsElapsed();
+        if(reader.hasError()) {
+            qFatal("%s", qPrintable(reader.errorString()));
+        }
+
+        *checksum = sum;
+        return elapsed;
+    }
+
+    //! \brief Returns the best time of several runs of \a pass.
+    qint64 bestOf(const QByteArray &data, Pass pass, qreal *checksum)
+    {
+        qint64 best = run(data, pass, checksum);
+        for(int i = 1; i < Repetitions; ++i) {
+            best = qMin(best, run(data, pass, checksum));
+        }
+
+        return best;
+    }
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int count = 100000;
+    if(app.arguments().size() > 1) {
+        count = qMax(1, app.arguments().at(1).toInt());
+    }
+
+    QByteArray data = createDocument(count);
+
+    qreal tokenizeSum;
+    qreal oldSum;
+    qreal newSum;
+    qint64 tokenizeTime = bestOf(data, TokenizeOnly, &tokenizeSum);
+    qint64 oldTime = bestOf(data, OldParsers, &oldSum);
+    qint64 newTime = bestOf(data, NewParsers, &newSum);
+
+    if(!qFuzzyCompare(oldSum, newSum)) {
+        qFatal("The old and new parsers returned different values");
+    }
+
+    QTextStream out(stdout);
+    out << count << " items, best of " << Repetitions << " runs\n";
+    out << "  tokenize only:  " << qreal(tokenizeTime) / count << " ns per item\n";
+    out << "  old parsers:    " << qreal(oldTime) / count << " ns per item ("
+        << qreal(oldTime - tokenizeTime) / count << " ns parsing attributes)\n";
+    out << "  new parsers:    " << qreal(newTime) / count << " ns per item ("
+        << qreal(newTime - tokenizeTime) / count << " ns parsing attributes)\n";
+
+    return 0;
+}
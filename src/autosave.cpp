@@ -0,0 +1,372 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "autosave.h"
+
+#include "documentviewmanager.h"
+#include "fileformats.h"
+#include "graphicsscene.h"
+#include "idocument.h"
+#include "settings.h"
+#include "xmlutilities.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QMessageBox>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUndoStack>
+#include <QtConcurrent>
+
+namespace Caneda
+{
+    //! \brief Magic number identifying an autosave file ("CNDA").
+    static const quint32 AutosaveMagic = 0x434E4441;
+    //! \brief Version of the autosave file format. Increment on format changes.
+    static const quint32 AutosaveVersion = 1;
+
+    //! \brief Constructor.
+    AutosaveManager::AutosaveManager(QObject *parent) :
+        QObject(parent),
+        m_fileCounter(0)
+    {
+        QDir().mkpath(autosaveDirectory());
+
+        // Hold a lock while running, so that other instances do not take
+        // this instance's files as left behind by a crash
+        QString pid = QString::number(QCoreApplication::applicationPid());
+        m_lockFile = new QLockFile(QDir(autosaveDirectory()).filePath(pid + ".lock"));
+        m_lockFile->tryLock(0);
+
+        m_timer = new QTimer(this);
+        connect(m_timer, &QTimer::timeout, this, &AutosaveManager::autosave);
+        updateSettingsChanges();
+    }
+
+    //! \copydoc MainWindow::instance()
+    AutosaveManager* AutosaveManager::instance()
+    {
+        static AutosaveManager *instance = nullptr;
+        if (!instance) {
+            instance = new AutosaveManager();
+        }
+        return instance;
+    }
+
+    //! \brief Destructor.
+    AutosaveManager::~AutosaveManager()
+    {
+        delete m_lockFile;
+    }
+
+    /*!
+     * \brief Offers to recover the documents autosaved by a crashed instance.
+     *
+     * The autosave files of instances not running anymore (those whose lock
+     * file is stale) are collected. If the user accepts, each document is
+     * written next to its original file (with a "-recovered" suffix, so the
+     * original file is never overwritten) and opened. The collected autosave
+     * files are removed afterwards.
+     */
+    void AutosaveManager::recover()
+    {
+        QDir dir(autosaveDirectory());
+        QString ownPid = QString::number(QCoreApplication::applicationPid());
+
+        // Collect the files left behind by crashed instances
+        QHash<QString, QStringList> filesByPid;
+        foreach(const QString &file, dir.entryList(QStringList("*.autosave"), QDir::Files)) {
+            QString pid = file.section('-', 0, 0);
+            if(pid != ownPid) {
+                filesByPid[pid] << dir.filePath(file);
+            }
+        }
+
+        QStringList orphanFiles;
+        for(QHash<QString, QStringList>::const_iterator it = filesByPid.constBegin();
+                it != filesByPid.constEnd(); ++it) {
+            QLockFile lock(dir.filePath(it.key() + ".lock"));
+            if(lock.tryLock(0)) {
+                orphanFiles << it.value();
+                lock.unlock();
+            }
+        }
+
+        // Read the autosaved documents
+        QStringList documentFileNames;
+        QList<QByteArray> documents;
+        foreach(const QString &fileName, orphanFiles) {
+            QFile file(fileName);
+            if(!file.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_5_0);
+
+            quint32 magic;
+            quint32 version;
+            QString documentFileName;
+            QDateTime time;
+            QByteArray compressed;
+            stream >> magic >> version >> documentFileName >> time >> compressed;
+
+            if(stream.status() != QDataStream::Ok ||
+                    magic != AutosaveMagic || version != AutosaveVersion) {
+                continue;
+            }
+
+            QByteArray data = qUncompress(compressed);
+            if(!data.isEmpty()) {
+                documentFileNames << documentFileName;
+                documents << data;
+            }
+        }
+
+        if(!documents.isEmpty()) {
+            QStringList names;
+            foreach(const QString &documentFileName, documentFileNames) {
+                names << (documentFileName.isEmpty() ? tr("Untitled") : documentFileName);
+            }
+
+            int answer = QMessageBox::question(nullptr, tr("Recover documents"),
+                    tr("Caneda was not closed properly, and the following documents "
+                       "have unsaved changes:\n\n%1\n\nDo you want to recover them?")
+                    .arg(names.join("\n")),
+                    QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+
+            if(answer == QMessageBox::Yes) {
+                for(int i = 0; i < documents.size(); ++i) {
+                    QString target = recoveredFileName(documentFileNames.at(i));
+
+                    QSaveFile file(target);
+                    if(!file.open(QIODevice::WriteOnly) ||
+                            file.write(documents.at(i)) != documents.at(i).size() ||
+                            !file.commit()) {
+                        QMessageBox::critical(nullptr, tr("Error"),
+                                tr("Cannot write recovered document %1").arg(target));
+                        continue;
+                    }
+
+                    DocumentViewManager::instance()->openFile(target);
+                }
+            }
+        }
+
+        foreach(const QString &fileName, orphanFiles) {
+            QFile::remove(fileName);
+        }
+    }
+
+    /*!
+     * \brief Removes all autosave files of this instance.
+     *
+     * This must be called when the application is closed normally, after the
+     * user chose to save or discard the changes of every document.
+     */
+    void AutosaveManager::clear()
+    {
+        m_timer->stop();
+
+        foreach(const Entry &entry, m_entries) {
+            if(entry.watcher) {
+                entry.watcher->waitForFinished();
+            }
+            QFile::remove(entry.fileName);
+        }
+
+        m_entries.clear();
+    }
+
+    //! \brief Applies the autosave interval from the application settings.
+    void AutosaveManager::updateSettingsChanges()
+    {
+        int interval = Settings::instance()->currentValue("autosave/interval").toInt();
+        if(interval > 0) {
+            m_timer->start(interval * 60 * 1000);
+        }
+        else {
+            m_timer->stop();
+        }
+    }
+
+    //! \brief Autosaves every modified schematic document.
+    void AutosaveManager::autosave()
+    {
+        foreach(IDocument *document, DocumentViewManager::instance()->documents()) {
+            SchematicDocument *schematic = qobject_cast<SchematicDocument*>(document);
+            if(schematic) {
+                autosaveDocument(schematic);
+            }
+        }
+    }
+
+    //! \brief Removes the autosave file of a closed document.
+    void AutosaveManager::documentDestroyed(QObject *document)
+    {
+        if(m_entries.contains(document)) {
+            // If being written, the file is removed once the worker finishes
+            if(!m_entries[document].watcher) {
+                QFile::remove(m_entries[document].fileName);
+            }
+            m_entries.remove(document);
+        }
+    }
+
+    /*!
+     * \brief Autosaves a schematic document, if changed since the last time.
+     *
+     * The document snapshot is taken here (in the gui thread), while the xml
+     * generation, compression and file writing are done in a worker thread.
+     */
+    void AutosaveManager::autosaveDocument(SchematicDocument *document)
+    {
+        if(!m_entries.contains(document)) {
+            Entry entry;
+            entry.fileName = QDir(autosaveDirectory()).filePath(
+                        QString("%1-%2.autosave")
+                        .arg(QCoreApplication::applicationPid())
+                        .arg(++m_fileCounter));
+            entry.dirty = true;
+            entry.watcher = nullptr;
+            m_entries.insert(document, entry);
+
+            QUndoStack *undoStack = document->graphicsScene()->undoStack();
+            connect(undoStack, &QUndoStack::indexChanged, this, [this, document]() {
+                if(m_entries.contains(document)) {
+                    m_entries[document].dirty = true;
+                }
+            });
+            connect(undoStack, &QUndoStack::cleanChanged, this, [this, document](bool clean) {
+                // Once saved, the autosaved data is not needed anymore
+                if(clean && m_entries.contains(document) && !m_entries[document].watcher) {
+                    QFile::remove(m_entries[document].fileName);
+                }
+            });
+            connect(document, &QObject::destroyed, this, &AutosaveManager::documentDestroyed);
+        }
+
+        Entry &entry = m_entries[document];
+        if(entry.watcher || !entry.dirty || !document->isModified()) {
+            return;
+        }
+
+        FormatXmlSchematic format(document);
+        SchematicSnapshot *snapshot = format.snapshot();
+        entry.dirty = false;
+
+        QString fileName = entry.fileName;
+        QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+            // The snapshot items must be deleted from the gui thread
+            delete snapshot;
+
+            if(m_entries.contains(document)) {
+                Entry &current = m_entries[document];
+                current.watcher = nullptr;
+                if(!watcher->result()) {
+                    current.dirty = true;
+                }
+                if(!document->isModified()) {
+                    QFile::remove(fileName);
+                }
+            }
+            else {
+                // The document was closed meanwhile
+                QFile::remove(fileName);
+            }
+
+            watcher->deleteLater();
+        });
+
+        entry.watcher = watcher;
+        watcher->setFuture(QtConcurrent::run(&AutosaveManager::writeAutosave,
+                                             snapshot, fileName, document->fileName()));
+    }
+
+    /*!
+     * \brief Writes a snapshot of a schematic into an autosave file.
+     *
+     * This method only reads the snapshot, and is run from a worker thread.
+     * The autosave file holds the original file name of the document and its
+     * compressed xml data, and is written atomically.
+     */
+    bool AutosaveManager::writeAutosave(const SchematicSnapshot *snapshot,
+                                        const QString &fileName,
+                                        const QString &documentFileName)
+    {
+        QByteArray data;
+        Caneda::XmlWriter writer(&data);
+        writer.setAutoFormatting(true);
+        FormatXmlSchematic::saveSnapshot(snapshot, &writer);
+
+        QSaveFile file(fileName);
+        if(!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << AutosaveMagic << AutosaveVersion << documentFileName
+               << QDateTime::currentDateTime() << qCompress(data);
+
+        return stream.status() == QDataStream::Ok && file.commit();
+    }
+
+    /*!
+     * \brief Returns a new file name to write a recovered document.
+     *
+     * The file is placed next to the original document (or in the home
+     * directory for untitled documents), and never overwrites an existing
+     * file.
+     */
+    QString AutosaveManager::recoveredFileName(const QString &documentFileName)
+    {
+        QFileInfo info(documentFileName);
+
+        QString path = QDir::homePath();
+        QString baseName = "untitled";
+        if(!documentFileName.isEmpty()) {
+            baseName = info.completeBaseName();
+            if(QFileInfo(info.absolutePath()).isWritable()) {
+                path = info.absolutePath();
+            }
+        }
+
+        QDir dir(path);
+        QString fileName = dir.filePath(baseName + "-recovered.xsch");
+        for(int i = 2; QFileInfo::exists(fileName); ++i) {
+            fileName = dir.filePath(QString("%1-recovered-%2.xsch").arg(baseName).arg(i));
+        }
+
+        return fileName;
+    }
+
+    //! \brief Returns the directory where autosave files are kept.
+    QString AutosaveManager::autosaveDirectory() const
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/autosave";
+    }
+
+} // namespace Caneda
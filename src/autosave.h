@@ -0,0 +1,108 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+// Forward declarations
+class QLockFile;
+class QTimer;
+
+namespace Caneda
+{
+    // Forward declarations.
+    class SchematicDocument;
+    class SchematicSnapshot;
+
+    /*!
+     * \brief This class handles the periodic autosave of the open schematics,
+     * and the recovery of the autosaved data after a crash.
+     *
+     * On each autosave, a SchematicSnapshot of every modified schematic is
+     * taken from the gui thread. The snapshot is cheap to take (property
+     * maps are implicitly shared), and it is written and compressed into an
+     * autosave file from a worker thread. In this way, editing never stalls
+     * while a big schematic is being serialized.
+     *
+     * Autosave files are kept in the application data directory, and are
+     * removed once the document is saved or closed. The files of each Caneda
+     * instance are guarded by a lock file, so on the next start only the
+     * files left behind by a crashed instance are offered for recovery (see
+     * recover()).
+     *
+     * This class is a singleton class and its only static instance (returned
+     * by instance()) is to be used.
+     *
+     * \sa FormatXmlSchematic::snapshot(), FormatXmlSchematic::saveSnapshot()
+     */
+    class AutosaveManager : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        static AutosaveManager* instance();
+        ~AutosaveManager() override;
+
+        void recover();
+        void clear();
+
+        void updateSettingsChanges();
+
+    private Q_SLOTS:
+        void autosave();
+        void documentDestroyed(QObject *document);
+
+    private:
+        explicit AutosaveManager(QObject *parent = nullptr);
+
+        void autosaveDocument(SchematicDocument *document);
+
+        static bool writeAutosave(const SchematicSnapshot *snapshot,
+                                  const QString &fileName,
+                                  const QString &documentFileName);
+        static QString recoveredFileName(const QString &documentFileName);
+
+        QString autosaveDirectory() const;
+
+        //! Autosave state of a document.
+        struct Entry
+        {
+            //! Autosave file of the document.
+            QString fileName;
+            //! True if the document changed since its last autosave.
+            bool dirty;
+            //! Watcher of the worker writing the document, if any.
+            QFutureWatcher<bool> *watcher;
+        };
+
+        QHash<QObject*, Entry> m_entries;
+        int m_fileCounter;
+
+        QTimer *m_timer;
+        QLockFile *m_lockFile;
+    };
+
+} // namespace Caneda
+
+#endif //AUTOSAVE_H
@@ -20,13 +20,14 @@
 
 #include "component.h"
 
+#include "graphicsscene.h"
 #include "library.h"
 #include "port.h"
-#include "settings.h"
 #include "xmlutilities.h"
 
 #include <QDebug>
 #include <QFile>
+#include <QHash>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
 
@@ -47,6 +48,11 @@ namespace Caneda
      * copying the reference to the PropertyGroup (properties) and all
      * components would share only one reference, modifying only one set
      * of properties data.
+     *
+     * The properties table of \a other is shared instead of copied, so that
+     * each component only stores the properties it changes.
+     *
+     * \sa PropertyGroup::shareProperties()
      */
     void ComponentData::setData(const QSharedDataPointer<ComponentData> &other)
     {
@@ -61,9 +67,10 @@ namespace Caneda
 
         // Recreate PropertyGroup (properties) as it is a pointer
         // and only internal data must be copied.
-        properties->setPropertyMap(other->properties->propertyMap());
+        properties->shareProperties(other->properties);
 
         models = other->models;
+        symbol = other->symbol;
     }
 
     /*!
@@ -86,7 +93,14 @@ namespace Caneda
     //! \brief Destructor.
     Component::~Component()
     {
+        // The scene is not notified of the removal of deleted items
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->removeComponentLabel(this);
+        }
+
         qDeleteAll(m_ports);
+        qDeleteAll(m_retiredPorts);
     }
 
     /*!
@@ -162,6 +176,79 @@ namespace Caneda
         updateSharedData();
     }
 
+    /*!
+     * \brief Replaces the library data of an already placed component.
+     *
+     * This method is used when the component's symbol file is reloaded from
+     * its library. Unlike setComponentData(), the ports are recreated and the
+     * user edited data (properties values and visibility, and properties
+     * position) is kept for the properties still present in the new data.
+     *
+     * The ports are referenced by the undo history (for example, by the
+     * connections recorded in a MoveItemsCmd), so they are never deleted
+     * here. The ports whose names are still present in the new data are
+     * kept and moved to their new positions, and the rest are retired:
+     * removed from the scene, but kept until the component is deleted.
+     *
+     * The caller is responsible for disconnecting the component's ports
+     * before this call, and connecting them again afterwards.
+     *
+     * \sa setComponentData(), LibraryManager::componentChanged()
+     */
+    void Component::updateComponentData(const ComponentDataPtr &other)
+    {
+        const PropertyMap oldProperties = d->properties->propertyMap();
+        const QPointF propertiesPos = d->properties->pos();
+
+        prepareGeometryChange();
+        QHash<QString, Port*> oldPorts;
+        foreach(Port *port, m_ports) {
+            if(oldPorts.contains(port->name())) {
+                m_retiredPorts << port;
+            }
+            else {
+                oldPorts.insert(port->name(), port);
+            }
+        }
+        m_ports.clear();
+
+        d->setData(other);
+        updateSharedData();
+
+        // Keep the existing ports instead of the recreated ones
+        for(int i = 0; i < m_ports.size(); ++i) {
+            Port *port = oldPorts.take(m_ports[i]->name());
+            if(port) {
+                port->setPos(m_ports[i]->pos());
+                delete m_ports[i];
+                m_ports[i] = port;
+            }
+        }
+
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        foreach(Port *port, oldPorts) {
+            m_retiredPorts << port;
+        }
+        if(graphicsScene) {
+            foreach(Port *port, m_retiredPorts) {
+                graphicsScene->removePort(port);
+            }
+        }
+
+        PropertyMap properties = d->properties->propertyMap();
+        foreach(const Property &oldProperty, oldProperties) {
+            if(properties.contains(oldProperty.name())) {
+                Property &property = properties[oldProperty.name()];
+                property.setValue(oldProperty.value());
+                property.setVisible(oldProperty.isVisible());
+            }
+        }
+        d->properties->setPropertyMap(properties);
+        d->properties->setPos(propertiesPos);
+
+        update();
+    }
+
     /*!
      * \brief Returns the specified model of a component.
      *
@@ -194,43 +281,56 @@ namespace Caneda
      * method also takes care of setting the correct global settings pen
      * according to its selection state.
      *
-     * \sa LibraryManager::registerComponent()
+     * The symbol is drawn from the pixmap atlas at the zoom bucket nearest to
+     * the current level of detail. Only when the zoom is out of the atlas
+     * range the symbol path is drawn directly. When zoomed out below
+     * Caneda::LodOutlineThreshold, only the symbol's bounding box outline is
+     * drawn. The pens are kept by the LibraryManager, so the settings are not
+     * queried on every paint.
+     *
+     * \sa LibraryManager::registerComponent(), LibraryManager::pixmapCache(),
+     * LibraryManager::symbolPen()
      */
     void Component::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
             QWidget *)
     {
         // Paint the component symbol
-        Settings *settings = Settings::instance();
         LibraryManager *libraryManager = LibraryManager::instance();
         QPainterPath symbol = libraryManager->symbolCache(name(), library());
 
-        // Save pen
-        QPen savedPen = painter->pen();
+        const bool selected = option->state & QStyle::State_Selected;
+        const qreal zoom = option->levelOfDetailFromTransform(painter->worldTransform());
 
-        if(option->state & QStyle::State_Selected) {
-            // If selected, the paint is performed without the pixmap cache
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+        QPen savedPen = painter->pen();
 
-            painter->drawPath(symbol);  // Draw symbol
+        if(zoom < Caneda::LodOutlineThreshold) {
+            // Far zoomed out, draw only the symbol outline with a cosmetic pen
+            painter->setPen(libraryManager->outlinePen(selected));
+            painter->setBrush(Qt::NoBrush);
+            painter->drawRect(symbol.boundingRect());
+            painter->setPen(savedPen);
+            return;
         }
-        else if(painter->worldTransform().isScaling()) {
-            // If zooming, the paint is performed without the pixmap cache
-            painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
 
-            painter->drawPath(symbol);  // Draw symbol
-        }
-        else {
-            // Else, a pixmap cached is used
-            QPixmap pix = libraryManager->pixmapCache(name(), library());
+        QPixmap pix = libraryManager->pixmapCache(name(), library(), zoom, selected);
+        if(!pix.isNull()) {
+            // A pixmap cached is used
             QRect rect =  symbol.boundingRect().toRect();
             rect.adjust(-1.0, -1.0, 1.0, 1.0);  // Adjust rect to avoid clipping when size = 1px in any dimension
-            painter->drawPixmap(rect, pix);
+            painter->drawPixmap(QRectF(rect), pix, QRectF(pix.rect()));
+            paintPorts(painter, option);
+            return;
         }
 
+        // If zoom is out of the atlas range, the paint is performed without
+        // the pixmap cache
+        painter->setPen(libraryManager->symbolPen(selected));
+        painter->drawPath(symbol);  // Draw symbol
+
         // Restore pen
         painter->setPen(savedPen);
+
+        paintPorts(painter, option);
     }
 
     //! \copydoc GraphicsItem::copy()
@@ -334,6 +434,34 @@ namespace Caneda
         return adjustedRect;
     }
 
+    /*!
+     * \brief Keeps the scene labels registry up to date.
+     *
+     * The component label is registered when the component is added to a
+     * scene, and unregistered when it is removed (for example, on delete or
+     * on undo of an insertion). Label changes are reported by the component
+     * properties.
+     *
+     * \sa GraphicsScene::insertComponentLabel(), GraphicsScene::removeComponentLabel()
+     */
+    QVariant Component::itemChange(GraphicsItemChange change, const QVariant &value)
+    {
+        if(change == ItemSceneChange) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                graphicsScene->removeComponentLabel(this);
+            }
+        }
+        else if(change == ItemSceneHasChanged) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                graphicsScene->insertComponentLabel(this);
+            }
+        }
+
+        return GraphicsItem::itemChange(change, value);
+    }
+
     //! \brief Updates the bounding rect of this item.
     void Component::updateBoundingRect()
     {
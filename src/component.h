@@ -22,6 +22,7 @@
 #define QCOMPONENT_H
 
 #include "graphicsitem.h"
+#include "objectpool.h"
 #include "property.h"
 
 namespace Caneda
@@ -56,6 +57,9 @@ namespace Caneda
 
         //! QMap with all the models available to the component.
         QMap<QString, QString> models;
+
+        //! Symbol drawing, as read from the library.
+        QPainterPath symbol;
     };
 
     typedef QSharedDataPointer<ComponentData> ComponentDataPtr;
@@ -82,6 +86,8 @@ namespace Caneda
         explicit Component(QGraphicsItem *parent = nullptr);
         ~Component() override;
 
+        CANEDA_POOLED_ALLOCATION(Component)
+
         //! \copydoc GraphicsItem::Type
         enum { Type = GraphicsItem::ComponentType };
         //! \copydoc GraphicsItem::type()
@@ -112,6 +118,7 @@ namespace Caneda
         //! Returns the component data.
         ComponentDataPtr componentData() const { return d; }
         void setComponentData(const ComponentDataPtr &other);
+        void updateComponentData(const ComponentDataPtr &other);
 
         //! Returns the property map (actually copy of property map).
         PropertyGroup* properties() const { return d->properties; }
@@ -129,6 +136,7 @@ namespace Caneda
 
     protected:
         QRectF adjustedBoundRect(const QRectF &rect);
+        QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
     public slots:
         void updateBoundingRect();
@@ -138,6 +146,16 @@ namespace Caneda
 
         //! \brief Component shared data
         ComponentDataPtr d;
+
+        /*!
+         * \brief Ports dropped when reloading the component data
+         *
+         * They are referenced by the undo history, so they are kept (detached
+         * from the scene) until the component is deleted.
+         *
+         * \sa updateComponentData()
+         */
+        QList<Port*> m_retiredPorts;
     };
 
 } // namespace Caneda
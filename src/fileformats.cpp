@@ -33,16 +33,31 @@
 #include "wire.h"
 #include "xmlutilities.h"
 
+#include <QDataStream>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QMessageBox>
 #include <QRegularExpression>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QSet>
 #include <QString>
+#include <QVector>
 #include <QtMath>
 
 namespace Caneda
 {
+    /*************************************************************************
+     *                          SchematicSnapshot                            *
+     *************************************************************************/
+    //! \brief Destructor.
+    SchematicSnapshot::~SchematicSnapshot()
+    {
+        qDeleteAll(paintings);
+    }
+
     /*************************************************************************
      *                         FormatXmlSchematic                            *
      *************************************************************************/
@@ -57,10 +72,15 @@ namespace Caneda
      * \brief Saves current scene data to an xml file.
      *
      * This method checks the file to be written is accessible and that the
-     * user has the correct permissions to write it, and then calls the
-     * saveText() method to generate the xml data to save.
+     * user has the correct permissions to write it, and then takes a
+     * snapshot() of the scene and writes it with saveSnapshot(). Autosave
+     * writes its snapshots with the same method, so documents and their
+     * backups are always written by a single code path.
+     *
+     * The data is written atomically through a QSaveFile, so a failed or
+     * interrupted save never leaves a truncated document behind.
      *
-     * \sa saveText(), load()
+     * \sa snapshot(), saveSnapshot(), load()
      */
     bool FormatXmlSchematic::save() const
     {
@@ -68,22 +88,26 @@ namespace Caneda
             return false;
         }
 
-        QString text = saveText();
-
-        if(text.isEmpty()) {
-            qDebug() << "Looks buggy! Null data to save! Was this expected?";
-        }
-
-        QFile file(fileName());
+        // Stream the xml data straight into a temporary file, which only
+        // replaces the document once completely written
+        QSaveFile file(fileName());
         if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QMessageBox::critical(nullptr, QObject::tr("Error"),
                     QObject::tr("Cannot save document!"));
             return false;
         }
 
-        QTextStream stream(&file);
-        stream << text;
-        file.close();
+        QScopedPointer<SchematicSnapshot> data(snapshot());
+
+        Caneda::XmlWriter writer(&file);
+        writer.setAutoFormatting(true);
+        saveSnapshot(data.data(), &writer);
+
+        if(writer.hasError() || !file.commit()) {
+            QMessageBox::critical(nullptr, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
 
         return true;
     }
@@ -119,143 +143,120 @@ namespace Caneda
     }
 
     /*!
-     * \brief Saves an xml file description into a QString, obtaining the data
-     * from a scene and associated objects (componts, paintings, etc).
+     * \brief Takes a snapshot of the scene data to be saved.
      *
-     * This method is used to generate an xml file into a QString to be saved
-     * by the save() method. Not only scene sections are created (components,
-     * paintings, etc) but also file header information, for example document
-     * version and name. Each section is created, in its turn, by calling an
-     * appropiated method an thus improving source code readability by
-     * splitting the different actions.
+     * This method must be called from the gui thread. It only copies the
+     * items data (properties are implicitly shared), so it is much cheaper
+     * than writing the xml data itself. Paintings are few and hold no shared
+     * data, so they are copied whole.
      *
-     * \return QString containing xml data to be saved.
+     * \return A newly allocated snapshot, to be written by saveSnapshot().
      *
-     * \sa save()
+     * \sa saveSnapshot(), SchematicSnapshot
      */
-    QString FormatXmlSchematic::saveText() const
+    SchematicSnapshot* FormatXmlSchematic::snapshot() const
     {
-        QString retVal;
-        Caneda::XmlWriter *writer = new Caneda::XmlWriter(&retVal);
-        writer->setAutoFormatting(true);
+        SchematicSnapshot *snapshot = new SchematicSnapshot;
+        GraphicsScene *scene = graphicsScene();
 
-        // Fist we start the document and write current version
-        writer->writeStartDocument();
-        writer->writeDTD(QString("<!DOCTYPE caneda>"));
-        writer->writeStartElement("caneda");
-        writer->writeAttribute("version", Caneda::version());
+        foreach(Component *c, scene->components()) {
+            SchematicSnapshot::ComponentRecord record;
+            record.name = c->name();
+            record.library = c->library();
+            record.pos = c->pos();
+            record.transform = c->sceneTransform();
+            record.propertiesPos = c->properties()->pos();
+            record.properties = c->properties()->propertyMap();
+            snapshot->components << record;
+        }
 
-        // Now we copy all the elements and properties in the schematic
-        saveComponents(writer);
-        savePorts(writer);
-        saveWires(writer);
-        savePaintings(writer);
+        foreach(PortSymbol *p, scene->portSymbols()) {
+            SchematicSnapshot::PortRecord record;
+            record.name = p->label();
+            record.pos = p->pos();
+            snapshot->ports << record;
+        }
 
-        // Finally we finish the document
-        writer->writeEndDocument(); //</caneda>
+        foreach(Wire *w, scene->wires()) {
+            SchematicSnapshot::WireRecord record;
+            record.start = w->port1()->scenePos();
+            record.end = w->port2()->scenePos();
+            snapshot->wires << record;
+        }
 
-        delete writer;
-        return retVal;
+        foreach(Painting *p, scene->paintings()) {
+            snapshot->paintings << p->copy();
+        }
+
+        return snapshot;
     }
 
     /*!
-     * \brief Saves the scene components to an XmlWriter.
+     * \brief Writes an xml file description from a snapshot of a scene.
      *
-     * This method saves all scene components to an XmlWriter. To do so, it
-     * takes each Component from the scene, and saves the data using the
-     * Component::saveData() method.
+     * This is the only writer of the schematic xml format, used both by
+     * save() and by the autosave. Not only scene sections are created
+     * (components, ports, wires and paintings) but also file header
+     * information, for example document version. As this method only reads
+     * the snapshot, it may be called from a worker thread.
      *
+     * \param snapshot Snapshot of the scene, as returned by snapshot().
      * \param writer XmlWriter responsible for writing the xml data.
      *
-     * \sa Component::saveData()
+     * \sa snapshot(), save()
      */
-    void FormatXmlSchematic::saveComponents(Caneda::XmlWriter *writer) const
+    void FormatXmlSchematic::saveSnapshot(const SchematicSnapshot *snapshot, Caneda::XmlWriter *writer)
     {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<Component*> components = filterItems<Component>(items);
+        writer->writeStartDocument();
+        writer->writeDTD(QString("<!DOCTYPE caneda>"));
+        writer->writeStartElement("caneda");
+        writer->writeAttribute("version", Caneda::version());
 
-        if(!components.isEmpty()) {
+        if(!snapshot->components.isEmpty()) {
             writer->writeStartElement("components");
-            foreach(Component *c, components) {
-                c->saveData(writer);
+            foreach(const SchematicSnapshot::ComponentRecord &record, snapshot->components) {
+                writer->writeStartElement("component");
+                writer->writeAttribute("name", record.name);
+                writer->writeAttribute("library", record.library);
+                writer->writePointAttribute(record.pos, "pos");
+                writer->writeTransformAttribute(record.transform);
+                PropertyGroup::writeProperties(writer, record.propertiesPos, record.properties);
+                writer->writeEndElement(); //</component>
             }
             writer->writeEndElement(); //</components>
         }
-    }
 
-    /*!
-     * \brief Saves the scene ports to an XmlWriter.
-     *
-     * This method saves all scene ports to an XmlWriter. To do so, it takes
-     * each PortSymbol from the scene, and saves the data using the
-     * PortSymbol::saveData() method.
-     *
-     * \param writer XmlWriter responsible for writing the xml data.
-     *
-     * \sa PortSymbol::saveData()
-     */
-    void FormatXmlSchematic::savePorts(Caneda::XmlWriter *writer) const
-    {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
-
-        if(!portSymbols.isEmpty()) {
+        if(!snapshot->ports.isEmpty()) {
             writer->writeStartElement("ports");
-            foreach(PortSymbol *p, portSymbols) {
-                p->saveData(writer);
+            foreach(const SchematicSnapshot::PortRecord &record, snapshot->ports) {
+                writer->writeStartElement("port");
+                writer->writeAttribute("name", record.name);
+                writer->writePointAttribute(record.pos, "pos");
+                writer->writeEndElement(); //</port>
             }
             writer->writeEndElement(); //</ports>
         }
-    }
 
-    /*!
-     * \brief Saves the scene wires to an XmlWriter.
-     *
-     * This method saves all scene wires to an XmlWriter. To do so, it takes
-     * each Wire from the scene, and saves the data using the Wire::saveData()
-     * method.
-     *
-     * \param writer XmlWriter responsible for writing the xml data.
-     *
-     * \sa Wire::saveData()
-     */
-    void FormatXmlSchematic::saveWires(Caneda::XmlWriter *writer) const
-    {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<Wire*> wires = filterItems<Wire>(items);
-
-        if(!wires.isEmpty()) {
+        if(!snapshot->wires.isEmpty()) {
             writer->writeStartElement("wires");
-            foreach(Wire *w, wires) {
-                w->saveData(writer);
+            foreach(const SchematicSnapshot::WireRecord &record, snapshot->wires) {
+                writer->writeStartElement("wire");
+                writer->writePointAttribute(record.start, "start");
+                writer->writePointAttribute(record.end, "end");
+                writer->writeEndElement(); //</wire>
             }
             writer->writeEndElement(); //</wires>
         }
-    }
 
-    /*!
-     * \brief Saves the scene paintings to an XmlWriter.
-     *
-     * This method saves all scene paintings to an XmlWriter. To do so, it
-     * takes each Painting from the scene, and saves the data using the
-     * GraphicsItem::saveData() method.
-     *
-     * \param writer XmlWriter responsible for writing the xml data.
-     *
-     * \sa GraphicsItem::saveData()
-     */
-    void FormatXmlSchematic::savePaintings(Caneda::XmlWriter *writer) const
-    {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<Painting*> paintings = filterItems<Painting>(items);
-
-        if(!paintings.isEmpty()) {
+        if(!snapshot->paintings.isEmpty()) {
             writer->writeStartElement("paintings");
-            foreach(Painting *p, paintings) {
+            foreach(const Painting *p, snapshot->paintings) {
                 p->saveData(writer);
             }
             writer->writeEndElement(); //</paintings>
         }
+
+        writer->writeEndDocument(); //</caneda>
     }
 
     /*!
@@ -268,6 +269,10 @@ namespace Caneda
     {
         Caneda::XmlReader *reader = new Caneda::XmlReader(text.toUtf8());
 
+        // Insert all items before resolving their connections
+        GraphicsScene *scene = graphicsScene();
+        scene->beginBulkLoad();
+
         while(!reader->atEnd()) {
             reader->readNext();
 
@@ -307,6 +312,8 @@ namespace Caneda
             }
         }
 
+        scene->endBulkLoad();
+
         if(reader->hasError()) {
             QMessageBox::critical(nullptr, QObject::tr("Xml parse error"), reader->errorString());
             delete reader;
@@ -472,6 +479,340 @@ namespace Caneda
     }
 
 
+    /*************************************************************************
+     *                        FormatBinarySchematic                          *
+     *************************************************************************/
+    //! \brief Magic number identifying a binary schematic file ("CNDB").
+    static const quint32 BinarySchematicMagic = 0x434E4442;
+    //! \brief Version of the binary schematic format. Increment on format changes.
+    static const quint32 BinarySchematicVersion = 1;
+
+    /*!
+     * \brief Helper class to intern the strings of a binary schematic.
+     *
+     * Each distinct string is stored only once, and referred to by its index.
+     */
+    class StringTable
+    {
+    public:
+        //! Returns the index of \a string, adding it to the table if needed.
+        quint32 index(const QString &string)
+        {
+            QHash<QString, quint32>::const_iterator it = m_indexes.constFind(string);
+            if(it != m_indexes.constEnd()) {
+                return it.value();
+            }
+
+            quint32 index = m_strings.size();
+            m_indexes.insert(string, index);
+            m_strings << string;
+            return index;
+        }
+
+        //! Returns all interned strings, in index order.
+        const QVector<QString>& strings() const { return m_strings; }
+
+    private:
+        QHash<QString, quint32> m_indexes;
+        QVector<QString> m_strings;
+    };
+
+    //! \brief Constructor.
+    FormatBinarySchematic::FormatBinarySchematic(SchematicDocument *document) :
+        QObject(document),
+        m_schematicDocument(document)
+    {
+    }
+
+    /*!
+     * \brief Saves current scene data to a binary file.
+     *
+     * The scene data is written through a SchematicSnapshot, atomically as in
+     * FormatXmlSchematic::save().
+     *
+     * \sa saveSnapshot(), load()
+     */
+    bool FormatBinarySchematic::save() const
+    {
+        if(!graphicsScene()) {
+            return false;
+        }
+
+        FormatXmlSchematic format(m_schematicDocument);
+        QScopedPointer<SchematicSnapshot> snapshot(format.snapshot());
+
+        QSaveFile file(fileName());
+        if(!file.open(QIODevice::WriteOnly) ||
+                !saveSnapshot(snapshot.data(), &file) || !file.commit()) {
+            QMessageBox::critical(nullptr, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Loads a binary file into the current scene.
+     *
+     * \sa loadFromData(), save()
+     */
+    bool FormatBinarySchematic::load() const
+    {
+        GraphicsScene *scene = graphicsScene();
+        if(!scene) {
+            return false;
+        }
+
+        QFile file(fileName());
+        if(!file.open(QIODevice::ReadOnly)) {
+            QMessageBox::critical(nullptr, QObject::tr("Error"),
+                    QObject::tr("Cannot load document ")+fileName());
+            return false;
+        }
+
+        bool result = loadFromData(file.readAll());
+        file.close();
+
+        return result;
+    }
+
+    /*!
+     * \brief Writes a snapshot of a scene into a binary schematic.
+     *
+     * The records are written first into a buffer, interning their strings,
+     * and then written after the string table. This method only reads the
+     * snapshot, and thus it may be called from a worker thread.
+     *
+     * \param snapshot Snapshot of the scene, as returned by
+     * FormatXmlSchematic::snapshot().
+     * \param device Device to write the binary data to.
+     * \return True on success, false otherwise.
+     */
+    bool FormatBinarySchematic::saveSnapshot(const SchematicSnapshot *snapshot, QIODevice *device)
+    {
+        StringTable strings;
+
+        QByteArray records;
+        QDataStream stream(&records, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        stream << quint32(snapshot->components.size());
+        foreach(const SchematicSnapshot::ComponentRecord &record, snapshot->components) {
+            // Only the transform components stored by the xml format are kept
+            const QTransform &t = record.transform;
+            stream << strings.index(record.name) << strings.index(record.library)
+                   << record.pos.x() << record.pos.y()
+                   << t.m11() << t.m12() << t.m13() << t.m21() << t.m22() << t.m23()
+                   << record.propertiesPos.x() << record.propertiesPos.y();
+
+            stream << quint32(record.properties.size());
+            foreach(const Property &property, record.properties) {
+                stream << strings.index(property.name()) << strings.index(property.value())
+                       << quint8(property.isVisible());
+            }
+        }
+
+        stream << quint32(snapshot->ports.size());
+        foreach(const SchematicSnapshot::PortRecord &record, snapshot->ports) {
+            stream << strings.index(record.name) << record.pos.x() << record.pos.y();
+        }
+
+        stream << quint32(snapshot->wires.size());
+        foreach(const SchematicSnapshot::WireRecord &record, snapshot->wires) {
+            stream << record.start.x() << record.start.y()
+                   << record.end.x() << record.end.y();
+        }
+
+        // Paintings are kept in their xml form
+        QByteArray paintings;
+        if(!snapshot->paintings.isEmpty()) {
+            Caneda::XmlWriter writer(&paintings);
+            writer.writeStartElement("paintings");
+            foreach(const Painting *p, snapshot->paintings) {
+                p->saveData(&writer);
+            }
+            writer.writeEndElement(); //</paintings>
+        }
+        stream << paintings;
+
+        // Write the header and the string table, followed by the records
+        QDataStream out(device);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << BinarySchematicMagic << BinarySchematicVersion << Caneda::version();
+
+        out << quint32(strings.strings().size());
+        foreach(const QString &string, strings.strings()) {
+            out << string;
+        }
+
+        out.writeRawData(records.constData(), records.size());
+
+        return out.status() == QDataStream::Ok;
+    }
+
+    /*!
+     * \brief Constructs the scene items from binary schematic data.
+     *
+     * Items are created as in FormatXmlSchematic::loadFromText(), with their
+     * connections resolved once all items are inserted.
+     *
+     * \param data Binary data to be read.
+     */
+    bool FormatBinarySchematic::loadFromData(const QByteArray &data) const
+    {
+        GraphicsScene *scene = graphicsScene();
+
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic;
+        quint32 version;
+        QString canedaVersion;
+        stream >> magic >> version >> canedaVersion;
+
+        if(stream.status() != QDataStream::Ok || magic != BinarySchematicMagic ||
+                version != BinarySchematicVersion || !Caneda::checkVersion(canedaVersion)) {
+            QMessageBox::critical(nullptr, QObject::tr("Error"),
+                    QObject::tr("Not a caneda file or probably malformatted file"));
+            return false;
+        }
+
+        quint32 count;
+        stream >> count;
+        QVector<QString> strings;
+        strings.reserve(qMin(count, quint32(data.size())));
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QString string;
+            stream >> string;
+            strings << string;
+        }
+
+        // Returns the string of an index, flagging the stream as corrupt if
+        // the index is out of range
+        auto string = [&](quint32 index) {
+            if(index >= quint32(strings.size())) {
+                stream.setStatus(QDataStream::ReadCorruptData);
+                return QString();
+            }
+            return strings.at(index);
+        };
+
+        scene->beginBulkLoad();
+
+        // Components
+        stream >> count;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            quint32 name, library, propertiesCount;
+            qreal x, y, m11, m12, m13, m21, m22, m23, propertiesX, propertiesY;
+            stream >> name >> library >> x >> y
+                   >> m11 >> m12 >> m13 >> m21 >> m22 >> m23
+                   >> propertiesX >> propertiesY >> propertiesCount;
+
+            Component *component = new Component();
+            component->setPos(x, y);
+            component->setTransform(QTransform(m11, m12, m13, m21, m22, m23, 0, 0, 1));
+
+            QString compName = string(name);
+            QString libName = string(library);
+            ComponentDataPtr componentData = LibraryManager::instance()->componentData(compName, libName);
+            if(componentData.constData()) {
+                component->setComponentData(componentData);
+            }
+            else {
+                qWarning() << "Warning: Found unknown element" << compName << ", skipping...";
+            }
+
+            PropertyMap properties = component->properties()->propertyMap();
+            for(quint32 j = 0; j < propertiesCount && stream.status() == QDataStream::Ok; ++j) {
+                quint32 propertyName, propertyValue;
+                quint8 visible;
+                stream >> propertyName >> propertyValue >> visible;
+
+                QString key = string(propertyName);
+                if(properties.contains(key)) {
+                    Property &property = properties[key];
+                    property.setValue(string(propertyValue));
+                    property.setVisible(visible);
+                }
+            }
+
+            if(componentData.constData()) {
+                component->properties()->setPropertyMap(properties);
+                component->properties()->setPos(propertiesX, propertiesY);
+            }
+
+            scene->addItem(component);
+            scene->connectItems(component);
+        }
+
+        // Port symbols
+        stream >> count;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            quint32 name;
+            qreal x, y;
+            stream >> name >> x >> y;
+
+            PortSymbol *portSymbol = new PortSymbol();
+            portSymbol->setPos(x, y);
+            portSymbol->setLabel(string(name));
+            scene->addItem(portSymbol);
+            scene->connectItems(portSymbol);
+        }
+
+        // Wires
+        stream >> count;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            qreal x1, y1, x2, y2;
+            stream >> x1 >> y1 >> x2 >> y2;
+
+            Wire *wire = new Wire(QPointF(x1, y1), QPointF(x2, y2));
+            scene->addItem(wire);
+            scene->connectItems(wire);
+        }
+
+        // Paintings
+        QByteArray paintings;
+        stream >> paintings;
+
+        scene->endBulkLoad();
+
+        if(stream.status() != QDataStream::Ok) {
+            QMessageBox::critical(nullptr, QObject::tr("Error"),
+                    QObject::tr("Not a caneda file or probably malformatted file"));
+            return false;
+        }
+
+        if(!paintings.isEmpty()) {
+            Caneda::XmlReader reader(paintings);
+            while(!reader.atEnd()) {
+                reader.readNext();
+                if(reader.isStartElement() && reader.name() == "paintings") {
+                    FormatXmlSchematic format(m_schematicDocument);
+                    format.loadPaintings(&reader);
+                }
+            }
+
+            if(reader.hasError()) {
+                QMessageBox::critical(nullptr, QObject::tr("Xml parse error"), reader.errorString());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    GraphicsScene* FormatBinarySchematic::graphicsScene() const
+    {
+        return m_schematicDocument ? m_schematicDocument->graphicsScene() : nullptr;
+    }
+
+    QString FormatBinarySchematic::fileName() const
+    {
+        return m_schematicDocument ? m_schematicDocument->fileName() : QString();
+    }
+
+
     /*************************************************************************
      *                           FormatXmlSymbol                             *
      *************************************************************************/
@@ -510,9 +851,12 @@ namespace Caneda
      *
      * This method checks the file to be written is accessible and that the
      * user has the correct permissions to write it, and then calls the
-     * saveText() method to generate the xml data to save.
+     * saveDocument() method to write the xml data.
+     *
+     * The data is written atomically through a QSaveFile, so a failed or
+     * interrupted save never leaves a truncated document behind.
      *
-     * \sa saveText(), load()
+     * \sa saveDocument(), load()
      */
     bool FormatXmlSymbol::save() const
     {
@@ -520,22 +864,24 @@ namespace Caneda
             return false;
         }
 
-        QString text = saveText();
-
-        if(text.isEmpty()) {
-            qDebug() << "Looks buggy! Null data to save! Was this expected?";
-        }
-
-        QFile file(fileName());
+        // Stream the xml data straight into a temporary file, which only
+        // replaces the document once completely written
+        QSaveFile file(fileName());
         if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QMessageBox::critical(nullptr, QObject::tr("Error"),
                     QObject::tr("Cannot save document!"));
             return false;
         }
 
-        QTextStream stream(&file);
-        stream << text;
-        file.close();
+        Caneda::XmlWriter writer(&file);
+        writer.setAutoFormatting(true);
+        saveDocument(&writer);
+
+        if(writer.hasError() || !file.commit()) {
+            QMessageBox::critical(nullptr, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
 
         return true;
     }
@@ -553,8 +899,10 @@ namespace Caneda
     {
         QFile file(fileName());
         if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QMessageBox::critical(nullptr, QObject::tr("Error"),
-                    QObject::tr("Cannot open file %1").arg(fileName()));
+            m_errorString = QObject::tr("Cannot open file %1").arg(fileName());
+            if(!component()) {
+                QMessageBox::critical(nullptr, QObject::tr("Error"), m_errorString);
+            }
             return false;
         }
 
@@ -581,26 +929,22 @@ namespace Caneda
     }
 
     /*!
-     * \brief Saves an xml file description into a QString, obtaining the data
-     * from a scene and associated objects (componts, paintings, etc).
+     * \brief Writes an xml file description into an XmlWriter, obtaining the
+     * data from a scene and associated objects (componts, paintings, etc).
      *
-     * This method is used to generate an xml file into a QString to be saved
-     * by the save() method. Not only scene sections are created (components,
+     * This method is used to stream an xml file to the device being saved by
+     * the save() method. Not only scene sections are created (components,
      * paintings, etc) but also file header information, for example document
      * version and name. Each section is created, in its turn, by calling an
      * appropiated method an thus improving source code readability by
      * splitting the different actions.
      *
-     * \return QString containing xml data to be saved.
+     * \param writer XmlWriter responsible for writing the xml data.
      *
      * \sa save()
      */
-    QString FormatXmlSymbol::saveText() const
+    void FormatXmlSymbol::saveDocument(Caneda::XmlWriter *writer) const
     {
-        QString retVal;
-        Caneda::XmlWriter *writer = new Caneda::XmlWriter(&retVal);
-        writer->setAutoFormatting(true);
-
         // Fist we start the document
         writer->writeStartDocument();
         writer->writeDTD(QString("<!DOCTYPE caneda>"));
@@ -636,9 +980,6 @@ namespace Caneda
 
         // Finally we finish the document
         writer->writeEndDocument(); //</component>
-
-        delete writer;
-        return retVal;
     }
 
     /*!
@@ -654,8 +995,7 @@ namespace Caneda
      */
     void FormatXmlSymbol::saveSymbol(XmlWriter *writer) const
     {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<Painting*> paintings = filterItems<Painting>(items);
+        const QVector<Painting*> &paintings = graphicsScene()->paintings();
 
         if(!paintings.isEmpty()) {
             writer->writeStartElement("symbol");
@@ -679,8 +1019,7 @@ namespace Caneda
      */
     void FormatXmlSymbol::savePorts(XmlWriter *writer) const
     {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
+        const QVector<PortSymbol*> &portSymbols = graphicsScene()->portSymbols();
 
         if(!portSymbols.isEmpty()) {
             writer->writeStartElement("ports");
@@ -739,14 +1078,13 @@ namespace Caneda
     void FormatXmlSymbol::saveModels(XmlWriter *writer) const
     {
         GraphicsScene *scene = graphicsScene();
-        QList<QGraphicsItem*> items = scene->items();
         PropertyGroup *properties = scene->properties();
         QFileInfo info(fileName());
 
         // Generate the spice model syntax
         QString syntax = "X%label";
 
-        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
+        const QVector<PortSymbol*> &portSymbols = scene->portSymbols();
         if(!portSymbols.isEmpty()) {
             foreach(PortSymbol *p, portSymbols) {
                 syntax.append(" %port{" + p->label() + "}");
@@ -813,8 +1151,8 @@ namespace Caneda
             }
             else if(component()) {
                 // We are opening the file as a component to include it in a library
-                component()->name = attributes.value("name").toString();
-                component()->labelPrefix = attributes.value("label").toString();
+                component()->name = Caneda::internString(attributes.value("name").toString());
+                component()->labelPrefix = Caneda::internString(attributes.value("label").toString());
             }
 
 
@@ -882,8 +1220,11 @@ namespace Caneda
         }
 
         if(reader->hasError()) {
-            qWarning() << "\nWarning: Failed to read data from\n" << fileName();
-            QMessageBox::critical(nullptr, QObject::tr("Xml parse error"), reader->errorString());
+            m_errorString = reader->errorString();
+            if(!component()) {
+                qWarning() << "\nWarning: Failed to read data from\n" << fileName();
+                QMessageBox::critical(nullptr, QObject::tr("Xml parse error"), m_errorString);
+            }
             delete reader;
             return false;
         }
@@ -899,8 +1240,6 @@ namespace Caneda
      */
     void FormatXmlSymbol::loadSymbol(Caneda::XmlReader *reader) const
     {
-        QPainterPath data;
-
         while(!reader->atEnd()) {
             reader->readNext();
 
@@ -919,26 +1258,71 @@ namespace Caneda
                     graphicsScene()->addItem(painting);
                 }
                 else if(component()) {
-                    // We are opening the file as a component to include it in a library
-                    QString name = reader->attributes().value("name").toString();
-                    Painting *newSymbol = Painting::fromName(name);
-                    newSymbol->loadData(reader);
+                    // We are opening the file as a component to include it
+                    // in a library, possibly from a worker thread. Paintings
+                    // access the settings and create gui objects, so only
+                    // their xml data is kept here. The symbol is created
+                    // later from the gui thread by symbolPath().
+                    QString paintingData;
+                    QXmlStreamWriter writer(&paintingData);
+                    writer.writeCurrentToken(*reader);
+
+                    int depth = 1;
+                    while(depth > 0 && !reader->atEnd()) {
+                        reader->readNext();
+                        writer.writeCurrentToken(*reader);
 
-                    QRectF rect = newSymbol->paintingRect();
-                    rect.moveTo(newSymbol->pos());
-                    data.addPath(newSymbol->shapeForRect(rect));
+                        if(reader->isStartElement()) {
+                            ++depth;
+                        }
+                        else if(reader->isEndElement()) {
+                            --depth;
+                        }
+                    }
 
-                    delete newSymbol;
+                    m_symbolPaintings << paintingData;
                 }
 
             }
         }
+    }
+
+    /*!
+     * \brief Creates the symbol drawing of a library component.
+     *
+     * This method must be called from the gui thread, as it creates the
+     * paintings of the symbol to obtain their shapes.
+     *
+     * \param paintings Xml data of each painting of the symbol, as returned
+     * by symbolPaintings().
+     * \return The symbol drawing, to be kept in ComponentData::symbol.
+     */
+    QPainterPath FormatXmlSymbol::symbolPath(const QStringList &paintings)
+    {
+        QPainterPath data;
+
+        foreach(const QString &paintingData, paintings) {
+            Caneda::XmlReader reader(paintingData.toUtf8());
+            while(!reader.atEnd() && !reader.isStartElement()) {
+                reader.readNext();
+            }
 
-        // If we are opening the file as a component, register the recreated QPainterPath
-        if(component()) {
-            LibraryManager *libraryManager = LibraryManager::instance();
-            libraryManager->registerComponent(component()->name, component()->library, data);
+            QString name = reader.attributes().value("name").toString();
+            Painting *painting = Painting::fromName(name);
+            if(!painting) {
+                continue;
+            }
+
+            painting->loadData(&reader);
+
+            QRectF rect = painting->paintingRect();
+            rect.moveTo(painting->pos());
+            data.addPath(painting->shapeForRect(rect));
+
+            delete painting;
         }
+
+        return data;
     }
 
     /*!
@@ -1131,10 +1515,16 @@ namespace Caneda
     QString FormatSpice::generateNetlist()
     {
         LibraryManager *libraryManager = LibraryManager::instance();
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<Component*> components = filterItems<Component>(items);
+        const QVector<Component*> components = graphicsScene()->components();
         PortsNetlist netlist = generateNetlistTopology();
 
+        // Net name of each port, for the port commands lookup
+        QHash<Port*, QString> netNames;
+        netNames.reserve(netlist.size());
+        foreach(const auto &node, netlist) {
+            netNames.insert(node.first, node.second);
+        }
+
         QStringList modelsList;
         QStringList subcircuitsList;
         QStringList directivesList;
@@ -1201,13 +1591,9 @@ namespace Caneda
 
                 if(commands.at(i).startsWith("%port")){
                     foreach(Port *_port, c->ports()) {
-                        if(_port->name() == parameter) {
-                            // Found the port, now look for its netlist name
-                            for(int j = 0; j < netlist.size(); ++j) {
-                                if(netlist.at(j).first == _port) {
-                                    model.replace(commands.at(i), netlist.at(j).second);
-                                }
-                            }
+                        if(_port->name() == parameter && netNames.contains(_port)) {
+                            // Found the port, now replace its netlist name
+                            model.replace(commands.at(i), netNames.value(_port));
                         }
                     }
                 }
@@ -1362,11 +1748,13 @@ namespace Caneda
             }
         }
 
-        // Save only named nodes
+        // Save only named nodes, skipping those already added by the probes
+        QSet<QString> savedNodes = nodesList.toSet();
+        QRegExp rx("\\d+");
         for(const auto &nn: netlist) {
-            QRegExp rx("\\d+");
-            if (!nodesList.contains(nn.second) &&
+            if (!savedNodes.contains(nn.second) &&
                 !rx.exactMatch(nn.second)) {
+                savedNodes.insert(nn.second);
                 nodesList.append(nn.second);
             }
         }
@@ -1433,32 +1821,40 @@ namespace Caneda
     {
         /*! \todo Investigate: If we use QList<GraphicsItem*> canedaItems = filterItems<Ports>(items);
          *  some phantom ports appear, and seem to be uninitialized, generating an ugly crash. Hence
-         *  we filter generic items and use an iteration over their ports as a workaround.
+         *  we use an iteration over the items ports (paintings have no ports) as a workaround.
          */
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<GraphicsItem*> canedaItems = filterItems<GraphicsItem>(items);
+        GraphicsScene *scene = graphicsScene();
         QList<Port*> ports;
-        foreach(GraphicsItem *i, canedaItems) {
-            ports << i->ports();
+        foreach(Component *c, scene->components()) {
+            ports << c->ports();
+        }
+        foreach(Wire *w, scene->wires()) {
+            ports << w->ports();
+        }
+        foreach(PortSymbol *p, scene->portSymbols()) {
+            ports << p->ports();
         }
 
         int equiId = 1;
         PortsNetlist netlist;
-        QList<Port*> parsedPorts;
+        QSet<Port*> parsedPorts;
 
         foreach(Port *p, ports) {
             if(parsedPorts.contains(p)) {
                 continue;
             }
 
+            // All the ports of a net share the same name string
+            const QString netName = QString::number(equiId);
+
             QList<Port*> equi;
             p->getEquipotentialPorts(equi);
             foreach(Port *_port, equi) {
-                netlist.append(qMakePair(_port, QString::number(equiId)));
+                netlist.append(qMakePair(_port, netName));
+                parsedPorts.insert(_port);
             }
 
             equiId++;
-            parsedPorts += equi;
         }
 
         replacePortNames(&netlist);
@@ -1482,31 +1878,48 @@ namespace Caneda
      */
     void FormatSpice::replacePortNames(PortsNetlist *netlist)
     {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
+        const QVector<PortSymbol*> &portSymbols = graphicsScene()->portSymbols();
+        if(portSymbols.isEmpty()) {
+            return;
+        }
+
+        // Index the netlist by port and by net name, to avoid scanning the
+        // whole netlist for each PortSymbol
+        QHash<Port*, int> portIndexes;
+        QHash<QString, QList<int> > netIndexes;
+        portIndexes.reserve(netlist->size());
+        for(int i = 0; i < netlist->size(); ++i) {
+            portIndexes.insert(netlist->at(i).first, i);
+            netIndexes[netlist->at(i).second] << i;
+        }
 
         // Iterate over all PortSymbols
         foreach(PortSymbol *p, portSymbols) {
 
             // Given the port, look for its netlist name
             QString netName;
-            for(int i = 0; i < netlist->size(); ++i) {
-                if(netlist->at(i).first == p->port()) {
-                    netName = netlist->at(i).second;
-                }
+            if(portIndexes.contains(p->port())) {
+                netName = netlist->at(portIndexes.value(p->port())).second;
+            }
+
+            QString newName;
+            if(p->label().toLower() == "ground" || p->label().toLower() == "gnd") {
+                newName = QString::number(0);
+            }
+            else {
+                newName = p->label();
+            }
+
+            if(netName == newName) {
+                continue;
             }
 
             // Given the netlist name, rename all occurencies with the new name
-            for(int i = 0; i < netlist->size(); ++i) {
-                if(netlist->at(i).second == netName) {
-                    if(p->label().toLower() == "ground" || p->label().toLower() == "gnd") {
-                        netlist->replace(i, qMakePair(netlist->at(i).first, QString::number(0)));
-                    }
-                    else {
-                        netlist->replace(i, qMakePair(netlist->at(i).first, p->label()));
-                    }
-                }
+            const QList<int> indexes = netIndexes.take(netName);
+            foreach(int i, indexes) {
+                netlist->replace(i, qMakePair(netlist->at(i).first, newName));
             }
+            netIndexes[newName] << indexes;
         }
     }
 
@@ -23,13 +23,17 @@
 
 #include "component.h"
 
+#include <QTransform>
+
 // Forward declarations
+class QIODevice;
 class QString;
 
 namespace Caneda
 {
     // Forward declarations
     class GraphicsScene;
+    class Painting;
     class ChartSeries;
     class ChartScene;
     class SchematicDocument;
@@ -40,6 +44,60 @@ namespace Caneda
 
     typedef QList<QPair<Port *, QString> > PortsNetlist;
 
+    /*!
+     * \brief This class holds an immutable copy of the data of a schematic.
+     *
+     * A snapshot is taken from the gui thread with
+     * FormatXmlSchematic::snapshot(), and holds the data needed to write the
+     * schematic file (positions, transforms, property maps and wires). It can
+     * then be written from a worker thread with
+     * FormatXmlSchematic::saveSnapshot(), while the scene is still being
+     * edited. Property maps are implicitly shared, so taking a snapshot does
+     * not copy the properties until they are modified in the scene.
+     *
+     * \sa FormatXmlSchematic, AutosaveManager
+     */
+    class SchematicSnapshot
+    {
+    public:
+        SchematicSnapshot() {}
+        ~SchematicSnapshot();
+
+        //! Data of a component.
+        struct ComponentRecord
+        {
+            QString name;
+            QString library;
+            QPointF pos;
+            QTransform transform;
+            QPointF propertiesPos;
+            PropertyMap properties;
+        };
+
+        //! Data of a port symbol.
+        struct PortRecord
+        {
+            QString name;
+            QPointF pos;
+        };
+
+        //! Data of a wire.
+        struct WireRecord
+        {
+            QPointF start;
+            QPointF end;
+        };
+
+        QList<ComponentRecord> components;
+        QList<PortRecord> ports;
+        QList<WireRecord> wires;
+        //! Unparented copies of the paintings, owned by the snapshot.
+        QList<Painting*> paintings;
+
+    private:
+        Q_DISABLE_COPY(SchematicSnapshot)
+    };
+
     /*!
      * \brief This class handles all the access to the schematic documents file
      * format.
@@ -61,13 +119,10 @@ namespace Caneda
         bool save() const;
         bool load() const;
 
-    private:
-        QString saveText() const;
-        void saveComponents(Caneda::XmlWriter *writer) const;
-        void savePorts(Caneda::XmlWriter *writer) const;
-        void saveWires(Caneda::XmlWriter *writer) const;
-        void savePaintings(Caneda::XmlWriter *writer) const;
+        SchematicSnapshot* snapshot() const;
+        static void saveSnapshot(const SchematicSnapshot *snapshot, Caneda::XmlWriter *writer);
 
+    private:
         bool loadFromText(const QString &text) const;
         void loadComponents(Caneda::XmlReader *reader) const;
         void loadPorts(Caneda::XmlReader *reader) const;
@@ -78,6 +133,49 @@ namespace Caneda
         QString fileName() const;
 
         SchematicDocument *m_schematicDocument;
+
+        friend class FormatBinarySchematic;
+    };
+
+    /*!
+     * \brief This class handles the binary schematic documents file format.
+     *
+     * The binary format holds the same data as the xml format (see
+     * FormatXmlSchematic), and both convert losslessly into each other, but
+     * it is much faster to load for big (usually generated) schematics. The
+     * file is made of:
+     *
+     * \li A header, with a magic number and the format and Caneda versions.
+     * \li A string table, where every string is stored only once (component
+     * and library names, property names and values, port names).
+     * \li Fixed width records for components, port symbols and wires,
+     * holding geometry as doubles and strings as indexes into the table.
+     * \li The paintings section, as in the xml format (paintings are few,
+     * and their data depends on each painting type).
+     *
+     * In this way, loading needs no attribute string parsing at all.
+     *
+     * \sa FormatXmlSchematic, \ref DocumentFormats
+     */
+    class FormatBinarySchematic : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit FormatBinarySchematic(SchematicDocument *document = nullptr);
+
+        bool save() const;
+        bool load() const;
+
+        static bool saveSnapshot(const SchematicSnapshot *snapshot, QIODevice *device);
+
+    private:
+        bool loadFromData(const QByteArray &data) const;
+
+        GraphicsScene* graphicsScene() const;
+        QString fileName() const;
+
+        SchematicDocument *m_schematicDocument;
     };
 
     /*!
@@ -89,6 +187,14 @@ namespace Caneda
      * formats, and has the access functions to return a SymbolDocument,
      * with all of its components.
      *
+     * When constructed from a ComponentData (library loading), this class
+     * does not create the symbol paintings (as they access the settings and
+     * create gui objects), and thus it may be used from worker threads. The
+     * xml data of the paintings is kept instead, and returned by
+     * symbolPaintings() to be converted into the symbol drawing by
+     * symbolPath() from the gui thread. Errors are not shown to the user but
+     * returned by errorString().
+     *
      * \sa \ref DocumentFormats
      */
     class FormatXmlSymbol : public QObject
@@ -102,8 +208,15 @@ namespace Caneda
         bool save() const;
         bool load() const;
 
+        //! Returns the last error found while loading a library component.
+        QString errorString() const { return m_errorString; }
+        //! Returns the xml data of the paintings of a library component.
+        QStringList symbolPaintings() const { return m_symbolPaintings; }
+
+        static QPainterPath symbolPath(const QStringList &paintings);
+
     private:
-        QString saveText() const;
+        void saveDocument(Caneda::XmlWriter *writer) const;
         void saveSymbol(Caneda::XmlWriter *writer) const;
         void savePorts(Caneda::XmlWriter *writer) const;
         void saveProperties(Caneda::XmlWriter *writer) const;
@@ -122,6 +235,9 @@ namespace Caneda
         SymbolDocument *m_symbolDocument;
         ComponentData *m_component;
         QString m_fileName;
+
+        mutable QString m_errorString;
+        mutable QStringList m_symbolPaintings;
     };
 
     /*!
@@ -22,6 +22,8 @@
 
 #include <QDir>
 #include <QIcon>
+#include <QMutex>
+#include <QSet>
 
 namespace Caneda
 {
@@ -80,6 +82,37 @@ namespace Caneda
         return QIcon::fromTheme(iconName, QIcon(Caneda::imageDirectory() + iconName + ".png"));
     }
 
+    /*!
+     * \brief Returns the interned (canonical) copy of a string.
+     *
+     * Identifiers such as component, library, port and property names are
+     * repeated in every loaded component and placed item. Interning them
+     * makes all equal identifiers share a single string buffer, which saves
+     * memory and makes comparing equal identifiers constant time (QString
+     * compares shared buffers by pointer before comparing contents).
+     *
+     * Interned strings are kept for the whole application lifetime. This
+     * function is thread safe, as libraries are parsed in worker threads.
+     */
+    QString internString(const QString &string)
+    {
+        static QMutex mutex;
+        static QSet<QString> pool;
+
+        if(string.isEmpty()) {
+            return string;
+        }
+
+        QMutexLocker locker(&mutex);
+        QSet<QString>::const_iterator it = pool.constFind(string);
+        if(it != pool.constEnd()) {
+            return *it;
+        }
+
+        pool.insert(string);
+        return string;
+    }
+
     QString localePrefix()
     {
         QString retVal = QLocale::system().name();
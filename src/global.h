@@ -81,6 +81,8 @@ namespace Caneda
     QString latexToUnicode(const QString& input);
     QString unicodeToLatex(QString unicode);
 
+    QString internString(const QString &string);
+
     //! \brief Possible mouse actions
     enum MouseAction {
         Wiring,             // Wire action
@@ -118,6 +120,25 @@ namespace Caneda
         AntiClockwise
     };
 
+    /*!
+     * \brief Level of detail below which items skip their secondary details
+     * (port markers and property texts).
+     */
+    static const qreal LodDetailsThreshold = 0.5;
+    /*!
+     * \brief Level of detail below which component symbols are drawn as
+     * bounding box outlines and wires as plain cosmetic lines.
+     */
+    static const qreal LodOutlineThreshold = 0.2;
+
+    /*!
+     * \brief Z value of the wires, which are drawn above the components and
+     * paintings.
+     *
+     * \sa WireLayer
+     */
+    static const qreal WireZValue = 1.0;
+
     //! \brief Render hints
     static const QPainter::RenderHints DefaulRenderHints = QPainter::Antialiasing | QPainter::SmoothPixmapTransform;
 
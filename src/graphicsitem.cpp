@@ -21,9 +21,13 @@
 #include "graphicsitem.h"
 
 #include "actionmanager.h"
+#include "graphicsscene.h"
+#include "port.h"
 
 #include <QGraphicsSceneEvent>
 #include <QMenu>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 
 namespace Caneda
 {
@@ -41,6 +45,16 @@ namespace Caneda
         setFlag(ItemSendsScenePositionChanges, true);
     }
 
+    //! \brief Destructor.
+    GraphicsItem::~GraphicsItem()
+    {
+        // The scene is not notified of the removal of deleted items
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->unregisterItem(this);
+        }
+    }
+
     /*!
      * \brief Rotate item by 90 degrees around a pivot point
      *
@@ -178,6 +192,48 @@ namespace Caneda
         item->setPos(pos());
     }
 
+    /*!
+     * \brief Keeps the scene typed registries and ports hash up to date.
+     *
+     * Ports are not graphics items, so the item moves its ports in the
+     * scene's ports hash whenever its scene position changes (for example,
+     * when it is moved or rotated).
+     *
+     * \sa GraphicsScene::registerItem(), GraphicsScene::unregisterItem(),
+     * GraphicsScene::insertPort(), GraphicsScene::removePort()
+     */
+    QVariant GraphicsItem::itemChange(GraphicsItemChange change, const QVariant &value)
+    {
+        if(change == ItemSceneChange) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                graphicsScene->unregisterItem(this);
+                foreach(Port *port, m_ports) {
+                    graphicsScene->removePort(port);
+                }
+            }
+        }
+        else if(change == ItemSceneHasChanged) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                graphicsScene->registerItem(this);
+                foreach(Port *port, m_ports) {
+                    graphicsScene->insertPort(port);
+                }
+            }
+        }
+        else if(change == ItemScenePositionHasChanged) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                foreach(Port *port, m_ports) {
+                    graphicsScene->insertPort(port);
+                }
+            }
+        }
+
+        return QGraphicsItem::itemChange(change, value);
+    }
+
     /*!
      * \brief Constructs and returns a context menu with the actions
      * corresponding to the selected object.
@@ -212,6 +268,26 @@ namespace Caneda
         }
     }
 
+    /*!
+     * \brief Draws the ports of the item.
+     *
+     * Ports are not graphics items, so each item must call this method from
+     * its paint() method. Port markers are not legible when zoomed out, so
+     * they are skipped below Caneda::LodDetailsThreshold.
+     *
+     * \sa Port::paint()
+     */
+    void GraphicsItem::paintPorts(QPainter *painter, const QStyleOptionGraphicsItem *option) const
+    {
+        if(option->levelOfDetailFromTransform(painter->worldTransform()) < Caneda::LodDetailsThreshold) {
+            return;
+        }
+
+        foreach(Port *port, m_ports) {
+            port->paint(painter, port->pos());
+        }
+    }
+
     /*!
      * \brief Sets the shape cache as well as boundbox cache
      *
@@ -61,6 +61,7 @@ namespace Caneda
     {
     public:
         explicit GraphicsItem(QGraphicsItem *parent = nullptr);
+        ~GraphicsItem() override;
 
         /*!
          * \brief GraphicsItem identification types.
@@ -152,9 +153,13 @@ namespace Caneda
         virtual void launchPropertiesDialog() = 0;
 
     protected:
+        QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+
         void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
         void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
 
+        void paintPorts(QPainter *painter, const QStyleOptionGraphicsItem *option) const;
+
         void setShapeAndBoundRect(const QPainterPath& path,
                 const QRectF& boundingRect,
                 qreal penWidth = 1.0);
@@ -29,23 +29,71 @@
 #include "graphictextdialog.h"
 #include "idocument.h"
 #include "iview.h"
+#include "library.h"
+#include "painting.h"
 #include "portsymbol.h"
 #include "property.h"
 #include "settings.h"
 #include "wire.h"
+#include "wirelayer.h"
 #include "xmlutilities.h"
 
 #include <QApplication>
 #include <QClipboard>
 #include <QGraphicsSceneEvent>
+#include <QHash>
 #include <QKeySequence>
 #include <QMenu>
+#include <QPair>
 #include <QPainter>
 #include <QShortcutEvent>
 #include <QtMath>
 
 namespace Caneda
 {
+    //! \brief Returns the key of a scene position in the ports hash.
+    static QPair<qint64, qint64> portKey(const QPointF &pos)
+    {
+        return qMakePair(qRound64(pos.x()), qRound64(pos.y()));
+    }
+
+    //! \brief Appends an item to a typed registry.
+    template<typename T>
+    static void registryAppend(QVector<T*> &registry, T *item, int type,
+                               QHash<GraphicsItem*, QPair<int, int> > &indexes)
+    {
+        indexes.insert(item, qMakePair(type, registry.size()));
+        registry.append(item);
+    }
+
+    /*!
+     * \brief Compacts a typed registry, removing its null slots.
+     *
+     * The remaining items keep their relative order, so the registries
+     * preserve the insertion order of the items, and files and netlists
+     * are written in a stable order.
+     */
+    template<typename T>
+    static void registryCompact(QVector<T*> &registry,
+                                QHash<GraphicsItem*, QPair<int, int> > &indexes)
+    {
+        int size = 0;
+        for(int i = 0; i < registry.size(); ++i) {
+            T *item = registry.at(i);
+            if(!item) {
+                continue;
+            }
+
+            if(size != i) {
+                registry[size] = item;
+                indexes[item].second = size;
+            }
+            ++size;
+        }
+
+        registry.resize(size);
+    }
+
     /*!
      * \brief Constructs a new graphics scene.
      *
@@ -63,8 +111,17 @@ namespace Caneda
         m_properties->setUserPropertiesEnabled(true);
         addItem(m_properties);
 
-        // Setup undo stack
+        // Setup the wire layer, before any wire is added
+        m_wireLayer = new WireLayer();
+        addItem(m_wireLayer);
+
+        // Setup undo stack. The history is unlimited by default. If an undo
+        // limit (in undo steps) is set, the oldest commands are dropped,
+        // releasing the items they hold, once the history reaches it.
+        // QUndoStack only supports a limit in steps, set while empty, so the
+        // history can not be bounded by its memory usage instead.
         m_undoStack = new QUndoStack(this);
+        m_undoStack->setUndoLimit(Settings::instance()->currentValue("undo/undoLimit").toInt());
 
         // Setup grid
         m_backgroundVisible = true;
@@ -91,7 +148,11 @@ namespace Caneda
 
         m_zoomBandClicks = 0;
 
+        m_bulkLoading = false;
+
         connect(undoStack(), &QUndoStack::cleanChanged, this, &GraphicsScene::changed);
+        connect(LibraryManager::instance(), &LibraryManager::componentChanged,
+                this, &GraphicsScene::updateComponents);
     }
 
     /**********************************************************************
@@ -640,6 +701,27 @@ namespace Caneda
         return rect.center();
     }
 
+    /*!
+     * \brief Moves a set of items by the same delta.
+     *
+     * Items with a parent item are moved in scene coordinates too, so that
+     * the whole set moves rigidly regardless of the parents' transforms.
+     *
+     * \param items The items to move.
+     * \param delta The displacement, in scene coordinates.
+     */
+    void GraphicsScene::moveItems(QList<GraphicsItem*> &items, const QPointF &delta)
+    {
+        foreach(GraphicsItem *item, items) {
+            if(item->parentItem()) {
+                item->setPos(item->parentItem()->mapFromScene(item->scenePos() + delta));
+            }
+            else {
+                item->setPos(item->pos() + delta);
+            }
+        }
+    }
+
     /*!
      * \brief Check for overlapping ports around the scene, and connect the
      * coinciding ports.
@@ -656,6 +738,11 @@ namespace Caneda
      */
     void GraphicsScene::connectItems(GraphicsItem *item)
     {
+        if(m_bulkLoading) {
+            m_deferredItems << item;
+            return;
+        }
+
         // Find existing intersecting ports and connect
         foreach(Port *port, item->ports()) {
             Port *other = port->findCoincidingPort();
@@ -695,6 +782,462 @@ namespace Caneda
         }
     }
 
+    /*!
+     * \brief Updates the connections of a set of items after transforming
+     * them as a whole.
+     *
+     * Only the ports whose connections do not coincide with them anymore are
+     * disconnected, before connecting the ports to the coinciding ones. In
+     * this way, when a block of items is rotated or mirrored, the connections
+     * between the items of the block are kept, and only those on the
+     * boundary of the block are recomputed.
+     *
+     * \param items: items to reconnect
+     *
+     * \sa connectItems(), disconnectItems()
+     */
+    void GraphicsScene::reconnectItems(QList<GraphicsItem*> &items)
+    {
+        foreach(GraphicsItem *item, items) {
+            foreach(Port *port, item->ports()) {
+                foreach(Port *other, *(port->connections())) {
+                    if(other->scenePos() != port->scenePos()) {
+                        port->disconnect();
+                        break;
+                    }
+                }
+            }
+        }
+
+        connectItems(items);
+    }
+
+    /*!
+     * \brief Starts a bulk load of items into the scene.
+     *
+     * While bulk loading (for example, while opening a schematic file),
+     * connectItems() calls are deferred. In this way, items are inserted
+     * without running a collision query against a scene index that is still
+     * growing, for every item added.
+     *
+     * \sa endBulkLoad()
+     */
+    void GraphicsScene::beginBulkLoad()
+    {
+        m_bulkLoading = true;
+        m_deferredItems.clear();
+    }
+
+    /*!
+     * \brief Ends a bulk load, connecting all loaded items in one pass.
+     *
+     * The ports of all deferred items are grouped by their scene position in
+     * a hash, and the ports sharing a position are connected. This takes
+     * linear time in the number of ports, instead of one collision query per
+     * loaded item.
+     *
+     * \sa beginBulkLoad(), connectItems()
+     */
+    void GraphicsScene::endBulkLoad()
+    {
+        m_bulkLoading = false;
+
+        QList<Port*> ports;
+        foreach(GraphicsItem *item, m_deferredItems) {
+            if(item->scene() == this) {
+                ports << item->ports();
+            }
+        }
+        m_deferredItems.clear();
+
+        connectCoincidingPorts(ports);
+    }
+
+    /*!
+     * \brief Adds a port to the ports hash, or updates its position.
+     *
+     * This is called by the items owning the ports, when added to the scene
+     * or whenever their scene position changes, and by the ports themselves
+     * when moved within their parent item.
+     *
+     * \sa removePort(), portsAt()
+     */
+    void GraphicsScene::insertPort(Port *port)
+    {
+        const QPair<qint64, qint64> key = portKey(port->scenePos());
+
+        QHash<Port*, QPair<qint64, qint64> >::iterator it = m_portKeys.find(port);
+        if(it != m_portKeys.end()) {
+            if(it.value() == key) {
+                return;
+            }
+            m_portHash.remove(it.value(), port);
+            it.value() = key;
+        }
+        else {
+            m_portKeys.insert(port, key);
+        }
+
+        m_portHash.insert(key, port);
+    }
+
+    //! \brief Removes a port from the ports hash.
+    void GraphicsScene::removePort(Port *port)
+    {
+        QHash<Port*, QPair<qint64, qint64> >::iterator it = m_portKeys.find(port);
+        if(it != m_portKeys.end()) {
+            m_portHash.remove(it.value(), port);
+            m_portKeys.erase(it);
+        }
+    }
+
+    /*!
+     * \brief Returns the ports near a scene position.
+     *
+     * Ports are hashed by their scene position rounded to integer
+     * coordinates, so the returned ports may be slightly off \a pos, and
+     * callers must compare the exact positions when needed. This lookup takes
+     * constant time, regardless of the number of items in the scene.
+     *
+     * \sa Port::findCoincidingPort()
+     */
+    QList<Port*> GraphicsScene::portsAt(const QPointF &pos) const
+    {
+        return m_portHash.values(portKey(pos));
+    }
+
+    /*!
+     * \brief Adds an item to the typed registry of its kind.
+     *
+     * This is called by the items themselves when added to the scene. The
+     * registries allow whole design passes (saving, netlisting, checks) to
+     * iterate the items of a given kind without calling items(), which
+     * collects and sorts all the items in the scene on every call.
+     *
+     * \sa unregisterItem(), components(), wires(), portSymbols(), paintings()
+     */
+    void GraphicsScene::registerItem(GraphicsItem *item)
+    {
+        if(m_itemIndexes.contains(item)) {
+            return;
+        }
+
+        if(Component *component = canedaitem_cast<Component*>(item)) {
+            registryAppend(m_components, component, GraphicsItem::ComponentType, m_itemIndexes);
+        }
+        else if(Wire *wire = canedaitem_cast<Wire*>(item)) {
+            registryAppend(m_wires, wire, GraphicsItem::WireType, m_itemIndexes);
+            m_wireLayer->insertWire(wire);
+        }
+        else if(PortSymbol *portSymbol = canedaitem_cast<PortSymbol*>(item)) {
+            registryAppend(m_portSymbols, portSymbol, GraphicsItem::PortSymbolType, m_itemIndexes);
+        }
+        else if(Painting *painting = canedaitem_cast<Painting*>(item)) {
+            registryAppend(m_paintings, painting, GraphicsItem::PaintingType, m_itemIndexes);
+        }
+    }
+
+    /*!
+     * \brief Removes an item from its typed registry.
+     *
+     * The item type is not queried here, as this is also called from the
+     * items destructor.
+     */
+    void GraphicsScene::unregisterItem(GraphicsItem *item)
+    {
+        QHash<GraphicsItem*, QPair<int, int> >::iterator it = m_itemIndexes.find(item);
+        if(it == m_itemIndexes.end()) {
+            return;
+        }
+
+        const int type = it.value().first;
+        const int index = it.value().second;
+        m_itemIndexes.erase(it);
+
+        switch(type) {
+        case GraphicsItem::ComponentType:
+            m_components[index] = nullptr;
+            break;
+        case GraphicsItem::WireType:
+        {
+            m_wireLayer->removeWire(static_cast<Wire*>(item));
+            m_wires[index] = nullptr;
+            break;
+        }
+        case GraphicsItem::PortSymbolType:
+            m_portSymbols[index] = nullptr;
+            break;
+        case GraphicsItem::PaintingType:
+            m_paintings[index] = nullptr;
+            break;
+        }
+
+        m_sparseRegistries.insert(type);
+    }
+
+    /*!
+     * \brief Returns the components in the scene, in insertion order.
+     *
+     * \sa registerItem()
+     */
+    const QVector<Component*>& GraphicsScene::components() const
+    {
+        if(m_sparseRegistries.remove(GraphicsItem::ComponentType)) {
+            registryCompact(m_components, m_itemIndexes);
+        }
+        return m_components;
+    }
+
+    //! \brief Returns the wires in the scene, in insertion order.
+    const QVector<Wire*>& GraphicsScene::wires() const
+    {
+        if(m_sparseRegistries.remove(GraphicsItem::WireType)) {
+            registryCompact(m_wires, m_itemIndexes);
+        }
+        return m_wires;
+    }
+
+    //! \brief Returns the port symbols in the scene, in insertion order.
+    const QVector<PortSymbol*>& GraphicsScene::portSymbols() const
+    {
+        if(m_sparseRegistries.remove(GraphicsItem::PortSymbolType)) {
+            registryCompact(m_portSymbols, m_itemIndexes);
+        }
+        return m_portSymbols;
+    }
+
+    //! \brief Returns the paintings in the scene, in insertion order.
+    const QVector<Painting*>& GraphicsScene::paintings() const
+    {
+        if(m_sparseRegistries.remove(GraphicsItem::PaintingType)) {
+            registryCompact(m_paintings, m_itemIndexes);
+        }
+        return m_paintings;
+    }
+
+    /*!
+     * \brief Updates a wire in the wire layer.
+     *
+     * This is called by the wires whenever their geometry or selection state
+     * changes. The wire layer redraws both the old and new wire areas, as
+     * the unselected wires are drawn by the layer.
+     *
+     * \sa WireLayer
+     */
+    void GraphicsScene::updateWire(Wire *wire)
+    {
+        if(!m_itemIndexes.contains(wire)) {
+            return;
+        }
+
+        m_wireLayer->updateWire(wire);
+    }
+
+    /*!
+     * \brief Adds a component to the labels registry, or updates its label.
+     *
+     * This is called by the components themselves when added to the scene,
+     * and by their properties whenever they change (for example, when the
+     * user edits the label or a property change is undone).
+     *
+     * \sa removeComponentLabel(), componentLabelSuffix()
+     */
+    void GraphicsScene::insertComponentLabel(Component *component)
+    {
+        ComponentLabel entry;
+        entry.label = component->label();
+        entry.prefix = component->labelPrefix();
+
+        bool ok;
+        entry.suffix = component->labelSuffix().toInt(&ok);
+        if(!ok || entry.suffix < 0) {
+            entry.suffix = 0;
+        }
+
+        QHash<Component*, ComponentLabel>::const_iterator it = m_componentLabels.constFind(component);
+        if(it != m_componentLabels.constEnd()) {
+            if(it.value().label == entry.label && it.value().prefix == entry.prefix) {
+                return;
+            }
+            removeComponentLabel(component);
+        }
+
+        m_componentLabels.insert(component, entry);
+        ++m_labelCounts[entry.label];
+        if(entry.suffix > 0) {
+            ++m_labelSuffixes[entry.prefix][entry.suffix];
+        }
+    }
+
+    //! \brief Removes a component from the labels registry.
+    void GraphicsScene::removeComponentLabel(Component *component)
+    {
+        QHash<Component*, ComponentLabel>::iterator it = m_componentLabels.find(component);
+        if(it == m_componentLabels.end()) {
+            return;
+        }
+
+        const ComponentLabel &entry = it.value();
+
+        if(--m_labelCounts[entry.label] <= 0) {
+            m_labelCounts.remove(entry.label);
+        }
+
+        if(entry.suffix > 0) {
+            QMap<int, int> &suffixes = m_labelSuffixes[entry.prefix];
+            if(--suffixes[entry.suffix] <= 0) {
+                suffixes.remove(entry.suffix);
+            }
+            if(suffixes.isEmpty()) {
+                m_labelSuffixes.remove(entry.prefix);
+            }
+        }
+
+        m_componentLabels.erase(it);
+    }
+
+    /*!
+     * \brief Returns an appropriate label suffix as 1 and 2 in R1, R2
+     *
+     * This method returns the highest suffix in use with \a prefix + 1 as the
+     * new suffix candidate. The suffixes are looked up in the labels
+     * registry, so there is no need to walk through the items on the scene.
+     *
+     * \sa insertComponentLabel()
+     */
+    int GraphicsScene::componentLabelSuffix(const QString& prefix) const
+    {
+        QHash<QString, QMap<int, int> >::const_iterator it = m_labelSuffixes.constFind(prefix);
+        if(it == m_labelSuffixes.constEnd() || it.value().isEmpty()) {
+            return 1;
+        }
+
+        return it.value().lastKey() + 1;
+    }
+
+    //! \brief Returns the labels used by more than one component.
+    QStringList GraphicsScene::duplicateComponentLabels() const
+    {
+        QStringList labels;
+        for(QHash<QString, int>::const_iterator it = m_labelCounts.constBegin();
+                it != m_labelCounts.constEnd(); ++it) {
+            if(it.value() > 1) {
+                labels << it.key();
+            }
+        }
+
+        labels.sort();
+        return labels;
+    }
+
+    /*!
+     * \brief Schedules the display update of a property group.
+     *
+     * This is called by the property groups themselves whenever a property
+     * changes. The updates are coalesced and performed once per event loop
+     * turn, so that several property changes in a row (for example, while
+     * loading or pasting components) lay out each group only once.
+     *
+     * \sa cancelPropertyDisplay(), PropertyGroup::updatePropertyDisplay()
+     */
+    void GraphicsScene::schedulePropertyDisplay(PropertyGroup *group)
+    {
+        if(m_pendingPropertyDisplays.isEmpty()) {
+            QMetaObject::invokeMethod(this, "updatePropertyDisplays", Qt::QueuedConnection);
+        }
+
+        m_pendingPropertyDisplays.insert(group);
+    }
+
+    //! \brief Cancels a scheduled display update of a property group.
+    void GraphicsScene::cancelPropertyDisplay(PropertyGroup *group)
+    {
+        m_pendingPropertyDisplays.remove(group);
+    }
+
+    /*!
+     * \brief Refresh the placed components reloaded from their library.
+     *
+     * This slot is called when a component's symbol file changes on disk.
+     * Only the instances of that component are updated (keeping their
+     * properties values), and their ports are connected again, as the port
+     * positions may have changed.
+     *
+     * \param compName Name of the reloaded component
+     * \param libName Library of the reloaded component
+     *
+     * \sa LibraryManager::componentChanged(), Component::updateComponentData()
+     */
+    void GraphicsScene::updateComponents(const QString &compName, const QString &libName)
+    {
+        ComponentDataPtr data;
+
+        foreach(Component *component, components()) {
+            if(component->name() != compName || component->library() != libName) {
+                continue;
+            }
+
+            if(!data) {
+                data = LibraryManager::instance()->componentData(compName, libName);
+                if(!data) {
+                    return;
+                }
+            }
+
+            disconnectItems(component);
+            component->updateComponentData(data);
+            connectItems(component);
+        }
+    }
+
+    /*!
+     * \brief Lays out the display of the property groups changed since the
+     * last event loop turn.
+     *
+     * \sa schedulePropertyDisplay(), PropertyGroup::layoutPropertyDisplay()
+     */
+    void GraphicsScene::updatePropertyDisplays()
+    {
+        const QSet<PropertyGroup*> groups = m_pendingPropertyDisplays;
+        m_pendingPropertyDisplays.clear();
+
+        foreach(PropertyGroup *group, groups) {
+            group->layoutPropertyDisplay();
+        }
+    }
+
+    /*!
+     * \brief Connects the ports (of different items) sharing a scene position.
+     *
+     * Ports are bucketed by their rounded scene position, so only ports in
+     * the same bucket are compared. Positions are compared exactly afterwards,
+     * as Port::connectTo() does.
+     *
+     * \param ports Ports to connect
+     */
+    void GraphicsScene::connectCoincidingPorts(const QList<Port*> &ports)
+    {
+        QHash<QPair<qint64, qint64>, QList<Port*> > buckets;
+        foreach(Port *port, ports) {
+            buckets[portKey(port->scenePos())] << port;
+        }
+
+        foreach(const QList<Port*> &bucket, buckets) {
+            for(int i = 1; i < bucket.size(); ++i) {
+                Port *port = bucket.at(i);
+                for(int j = 0; j < i; ++j) {
+                    Port *other = bucket.at(j);
+                    if(other->parentItem() != port->parentItem() &&
+                            other->scenePos() == port->scenePos() &&
+                            !port->isConnectedTo(other)) {
+                        port->connectTo(other);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
     /*!
      * \brief Search wire collisions and if found split the wire.
      *
@@ -717,13 +1260,13 @@ namespace Caneda
             // List of wires to delete after collision and creation of new wires
             QList<Wire*> markedForDeletion;
 
-            // Detect all colliding items
-            QList<QGraphicsItem*> collisions = port->collidingItems(Qt::IntersectsItemBoundingRect);
+            // Detect all colliding wires, looked up in the wire layer index
+            const QVector<Wire*> collisions = m_wireLayer->wires(portEllipse.translated(port->scenePos()));
 
-            // Filter colliding wires only
-            foreach(QGraphicsItem *collidingItem, collisions) {
-                Wire* collidingWire = canedaitem_cast<Wire*>(collidingItem);
-                if(collidingWire) {
+            // Filter wires actually passing over the port (the bounding rect
+            // of a diagonal wire extends far off the wire itself)
+            foreach(Wire *collidingWire, collisions) {
+                if(collidingWire->contains(collidingWire->mapFromScene(port->scenePos()))) {
 
                     // If already connected, the collision is the result of the connection,
                     // otherwise there is a potential new node.
@@ -1150,7 +1693,6 @@ namespace Caneda
                         if((event->buttons() & Qt::LeftButton) && !selectedItems().isEmpty()) {
                             // Items are selected and we are begining a new move operation
                             m_areItemsMoving = true;
-                            m_undoStack->beginMacro(tr("Move items"));
 
                             disconnectDisconnectibles();
                             QGraphicsScene::mouseMoveEvent(event);
@@ -1174,7 +1716,6 @@ namespace Caneda
                     if(m_areItemsMoving) {
                         m_areItemsMoving = false;
                         endSpecialMove();
-                        m_undoStack->endMacro();
                     }
                     QGraphicsScene::mouseReleaseEvent(event);
                 }
@@ -1726,31 +2267,6 @@ namespace Caneda
         m_undoStack->endMacro();
     }
 
-    /*!
-     * \brief Returns an appropriate label suffix as 1 and 2 in R1, R2
-     *
-     * This method walks through all the items on the scene matching the
-     * labelprefix and uses the highest of these suffixes + 1 as the new
-     * suffix candidate.
-     */
-    int GraphicsScene::componentLabelSuffix(const QString& prefix) const
-    {
-        int max = 1;
-
-        foreach(QGraphicsItem *item, items()) {
-            Component *comp = canedaitem_cast<Component*>(item);
-            if(comp && comp->labelPrefix() == prefix) {
-                bool ok;
-                int suffix = comp->labelSuffix().toInt(&ok);
-                if(ok) {
-                    max = qMax(max, suffix+1);
-                }
-            }
-        }
-
-        return max;
-    }
-
     /******************************************************************
      *
      *                   Moving Events
@@ -1782,6 +2298,8 @@ namespace Caneda
     {
         disconnectibles.clear();
         specialMoveItems.clear();
+        moveDisconnections.clear();
+        moveStretchedWires.clear();
 
         foreach(QGraphicsItem *qItem, selectedItems()) {
             GraphicsItem *item = canedaitem_cast<GraphicsItem*>(qItem);
@@ -1817,6 +2335,27 @@ namespace Caneda
                 }
             }
         }
+
+        // Keep the initial geometry of the items following the move, to
+        // record it in the undo command
+        QSet<GraphicsItem*> followers;
+        foreach(GraphicsItem *item, specialMoveItems) {
+            if(followers.contains(item)) {
+                continue;
+            }
+            followers << item;
+
+            if(item->type() == GraphicsItem::WireType) {
+                Wire *wire = canedaitem_cast<Wire*>(item);
+                WireStretch stretch;
+                stretch.wire = wire;
+                stretch.oldLine = QLineF(wire->port1()->scenePos(), wire->port2()->scenePos());
+                moveStretchedWires << stretch;
+            }
+            else {
+                item->storePos();
+            }
+        }
     }
 
     /*!
@@ -1894,28 +2433,76 @@ namespace Caneda
     /*!
      * \brief End the special move and finalize wire's segements.
      *
-     * This method ends the special move by pushing the necessary UndoCommands
-     * relative to position changes of items on a scene. Also finalize wire's
-     * segments.
+     * This method ends the special move by pushing a single MoveItemsCmd for
+     * all the moved items, along with the stretched wires and the port
+     * symbols that followed them. Also finalize wire's segments.
      *
      * \sa normalEvent()
      */
     void GraphicsScene::endSpecialMove()
     {
+        // Items whose parent is selected are moved along with their parent
+        QList<GraphicsItem*> items;
         foreach(QGraphicsItem *qItem, selectedItems()) {
             GraphicsItem *item = canedaitem_cast<GraphicsItem*>(qItem);
 
-            if(item) {
-                m_undoStack->push(new MoveItemCmd(item, item->storedPos(),
-                            smartNearingGridPoint(item->pos())));
+            if(item && !(item->parentItem() && item->parentItem()->isSelected())) {
+                items << item;
+            }
+        }
 
-                connectItems(item);
-                splitAndCreateNodes(item);
+        if(!items.isEmpty()) {
+            // The whole selection is moved by the same (grid snapped) delta,
+            // recorded in a single command along with the disconnections.
+            GraphicsItem *reference = items.first();
+            QPointF initialPos = reference->storedPos();
+            if(reference->parentItem()) {
+                initialPos = reference->parentItem()->mapToScene(initialPos);
+            }
+            const QPointF delta = smartNearingGridPoint(reference->scenePos()) - initialPos;
+
+            // Snap the items, and let the attached wires follow them, so that
+            // their ends coincide with the moved ports when reconnecting.
+            foreach(GraphicsItem *item, items) {
+                item->setPos(item->storedPos());
+            }
+            moveItems(items, delta);
+            specialMove();
+
+            // Record the final ends of the stretched wires. The port symbols
+            // following the move are moved along with the items.
+            for(int i = 0; i < moveStretchedWires.size(); ++i) {
+                Wire *wire = moveStretchedWires[i].wire;
+                moveStretchedWires[i].newLine = QLineF(wire->port1()->scenePos(),
+                                                       wire->port2()->scenePos());
+                wire->movePort1(moveStretchedWires[i].oldLine.p1());
+                wire->movePort2(moveStretchedWires[i].oldLine.p2());
             }
+
+            foreach(GraphicsItem *item, specialMoveItems) {
+                if(item->type() == GraphicsItem::PortSymbolType && !items.contains(item)) {
+                    items << item;
+                }
+            }
+
+            // Bring the items back to their initial positions, as the
+            // command applies the delta.
+            foreach(GraphicsItem *item, items) {
+                item->setPos(item->storedPos());
+            }
+
+            MoveItemsCmd *cmd = new MoveItemsCmd(items, delta, moveDisconnections,
+                                                 moveStretchedWires, this);
+            cmd->setText(tr("Move items"));
+            m_undoStack->push(cmd);
+
+            splitAndCreateNodes(items);
         }
 
         specialMoveItems.clear();
         disconnectibles.clear();
+        moveDisconnections.clear();
+        moveStretchedWires.clear();
     }
 
     /*!
@@ -1926,6 +2513,9 @@ namespace Caneda
      * when two (or more) components are connected and one of them is clicked
      * and dragged, or when a wire is moved away from a (unselected) component.
      *
+     * The broken connections are kept in moveDisconnections, to be recorded
+     * in the undo command of the move by endSpecialMove().
+     *
      * \sa normalEvent(), processForSpecialMove()
      */
     void GraphicsScene::disconnectDisconnectibles()
@@ -1942,7 +2532,8 @@ namespace Caneda
                             other->parentItem() != item &&
                             !other->parentItem()->isSelected()) {
 
-                        m_undoStack->push(new DisconnectCmd(port, other));
+                        port->disconnect();
+                        moveDisconnections << PortPair(port, other);
                         ++disconnections;
 
                         break;
@@ -26,7 +26,13 @@
 
 #include <QGraphicsItem>
 #include <QGraphicsScene>
+#include <QHash>
 #include <QList>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
 
 #include <QtPrintSupport/QPrinter>
 
@@ -39,7 +45,10 @@ namespace Caneda
     class Component;
     class GraphicsItem;
     class Painting;
+    class Port;
+    class PortSymbol;
     class Wire;
+    class WireLayer;
 
     /*!
      * \brief This class provides a canvas for managing graphics elements
@@ -101,11 +110,37 @@ namespace Caneda
 
         // Connect/disconnect methods
         QPointF centerOfItems(const QList<GraphicsItem*> &items);
+        void moveItems(QList<GraphicsItem*> &items, const QPointF &delta);
 
         void connectItems(GraphicsItem *item);
         void connectItems(QList<GraphicsItem *> &items);
         void disconnectItems(GraphicsItem *item);
         void disconnectItems(QList<GraphicsItem *> &items);
+        void reconnectItems(QList<GraphicsItem *> &items);
+
+        void beginBulkLoad();
+        void endBulkLoad();
+
+        void insertPort(Port *port);
+        void removePort(Port *port);
+        QList<Port*> portsAt(const QPointF &pos) const;
+
+        void registerItem(GraphicsItem *item);
+        void unregisterItem(GraphicsItem *item);
+        void updateWire(Wire *wire);
+
+        const QVector<Component*>& components() const;
+        const QVector<Wire*>& wires() const;
+        const QVector<PortSymbol*>& portSymbols() const;
+        const QVector<Painting*>& paintings() const;
+
+        void insertComponentLabel(Component *component);
+        void removeComponentLabel(Component *component);
+        int componentLabelSuffix(const QString& labelPrefix) const;
+        QStringList duplicateComponentLabels() const;
+
+        void schedulePropertyDisplay(PropertyGroup *group);
+        void cancelPropertyDisplay(PropertyGroup *group);
 
         void splitAndCreateNodes(GraphicsItem *item);
         void splitAndCreateNodes(QList<GraphicsItem *> &items);
@@ -117,6 +152,10 @@ namespace Caneda
         PropertyGroup* properties() { return m_properties; }
         void addProperty(Property property);
 
+    private Q_SLOTS:
+        void updateComponents(const QString &compName, const QString &libName);
+        void updatePropertyDisplays();
+
     Q_SIGNALS:
         //! \brief This signal is emitted whenever the undostack enters or leaves the clean state.
         void changed();
@@ -164,7 +203,6 @@ namespace Caneda
 
         // Custom private methods
         void placeItem(GraphicsItem *item, const QPointF &pos);
-        int componentLabelSuffix(const QString& labelPrefix) const;
 
         void processForSpecialMove();
         void specialMove();
@@ -172,6 +210,8 @@ namespace Caneda
         void disconnectDisconnectibles();
         void resetState();
 
+        void connectCoincidingPorts(const QList<Port*> &ports);
+
         bool eventFilter(QObject *object, QEvent *event) override;
         void blockShortcuts(bool block);
 
@@ -231,6 +271,24 @@ namespace Caneda
          */
         QList<GraphicsItem*> specialMoveItems;
 
+        /*!
+         * \brief Port connections broken when the current move started
+         *
+         * The disconnections are performed in disconnectDisconnectibles(), and
+         * recorded in the MoveItemsCmd pushed by endSpecialMove(), so that
+         * they are restored when the move is undone.
+         */
+        QList<PortPair> moveDisconnections;
+
+        /*!
+         * \brief Unselected wires stretched by the current move
+         *
+         * The wire ends are stored in processForSpecialMove(), before the
+         * move, and completed in endSpecialMove() with the final ends, to be
+         * recorded in the MoveItemsCmd.
+         */
+        QList<WireStretch> moveStretchedWires;
+
         /*!
          * \brief State variable for the current wire state.
          *
@@ -270,6 +328,66 @@ namespace Caneda
 
         //! \brief Spice/electric related scene properties
         PropertyGroup *m_properties;
+
+        /*!
+         * \brief Flag to hold whether items are being bulk loaded
+         * \sa beginBulkLoad(), endBulkLoad()
+         */
+        bool m_bulkLoading;
+
+        //! \brief Items whose connections are deferred until endBulkLoad()
+        QList<GraphicsItem*> m_deferredItems;
+
+        /*!
+         * \brief Hash of the ports in the scene, by (rounded) scene position
+         * \sa portsAt()
+         */
+        QMultiHash<QPair<qint64, qint64>, Port*> m_portHash;
+        //! \brief Current key of each port in m_portHash
+        QHash<Port*, QPair<qint64, qint64> > m_portKeys;
+
+        /*!
+         * \brief Typed registries of the Caneda items in the scene
+         *
+         * The items are kept in insertion order. Removed items leave a null
+         * slot, and the registry is compacted on its next access.
+         */
+        mutable QVector<Component*> m_components;
+        mutable QVector<Wire*> m_wires;
+        mutable QVector<PortSymbol*> m_portSymbols;
+        mutable QVector<Painting*> m_paintings;
+        //! \brief Type and index of each registered item in its typed registry
+        mutable QHash<GraphicsItem*, QPair<int, int> > m_itemIndexes;
+        //! \brief Types of the registries holding null slots
+        mutable QSet<int> m_sparseRegistries;
+
+        //! \brief Layer drawing the unselected wires
+        WireLayer *m_wireLayer;
+
+        //! \brief Label of a component, as registered in the labels registry
+        struct ComponentLabel
+        {
+            QString label;
+            QString prefix;
+            //! Numeric label suffix, or 0 if the label has no valid suffix
+            int suffix;
+        };
+
+        //! \brief Registered label of each component in the scene
+        QHash<Component*, ComponentLabel> m_componentLabels;
+        //! \brief Number of components using each label
+        QHash<QString, int> m_labelCounts;
+        /*!
+         * \brief Used label suffixes (and their number of uses) by label prefix
+         * \sa componentLabelSuffix()
+         */
+        QHash<QString, QMap<int, int> > m_labelSuffixes;
+
+        /*!
+         * \brief Property groups whose display must be laid out again
+         * \sa schedulePropertyDisplay(), updatePropertyDisplays()
+         */
+        QSet<PropertyGroup*> m_pendingPropertyDisplays;
     };
 
 } // namespace Caneda
@@ -200,6 +200,11 @@ namespace Caneda
             }
 
             qDebug() << "Successfully loaded libraries!";
+
+            // Keep the sidebar up to date with the symbol files on disk
+            connect(libraryManager, &LibraryManager::libraryChanged, this, [this](const QString &library) {
+                m_sidebarItems->reloadLibrary(library, "Components");
+            });
         }
         else {
             // Invalidate entry
@@ -245,6 +250,7 @@ namespace Caneda
     {
         QStringList nameFilters;
         nameFilters << QObject::tr("Schematic-xml (*.xsch)");
+        nameFilters << QObject::tr("Schematic-binary (*.bsch)");
 
         return nameFilters;
     }
@@ -255,6 +261,7 @@ namespace Caneda
         // provided by defaultSuffix() for all dialogs.
         QStringList supportedSuffixes;
         supportedSuffixes << "xsch";
+        supportedSuffixes << "bsch";
 
         return supportedSuffixes;
     }
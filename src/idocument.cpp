@@ -534,7 +534,7 @@ namespace Caneda
         QString path = info.path();
 
         // First export the schematic to a spice netlist
-        if(info.suffix() == "xsch") {
+        if(info.suffix() == "xsch" || info.suffix() == "bsch") {
             FormatSpice *format = new FormatSpice(this);
             format->save();
         }
@@ -594,6 +594,11 @@ namespace Caneda
             return format->load();
         }
 
+        if(info.suffix() == "bsch") {
+            FormatBinarySchematic *format = new FormatBinarySchematic(this);
+            return format->load();
+        }
+
         if (errorMessage) {
             *errorMessage = tr("Unknown file format!");
         }
@@ -622,6 +627,16 @@ namespace Caneda
             return true;
         }
 
+        if(info.suffix() == "bsch") {
+            FormatBinarySchematic *format = new FormatBinarySchematic(this);
+            if(!format->save()) {
+                return false;
+            }
+
+            m_graphicsScene->undoStack()->clear();
+            return true;
+        }
+
         if(errorMessage) {
             *errorMessage = tr("Unknown file format!");
         }
@@ -846,15 +861,10 @@ namespace Caneda
         //***************************************
         // Check for the presence of a ground net
         //***************************************
-        // Get a list of all the items in the scene
-        QList<QGraphicsItem*> items = m_graphicsScene->items();
-
         bool foundGroundNet = false;
 
         // Iterate over all PortSymbols
-        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
-
-        foreach(PortSymbol *p, portSymbols) {
+        foreach(PortSymbol *p, m_graphicsScene->portSymbols()) {
             if(p->label().toLower() == "ground" || p->label().toLower() == "gnd") {
                 foundGroundNet = true;
             }
@@ -883,13 +893,10 @@ namespace Caneda
         //***********************************************
         bool foundSimulationProfile = false;
 
-        // Iterate over all components
-        QList<Component*> components = filterItems<Component>(items);
-
         // Check for a component that starts with "Sim" as keyword. Although
         // theoretically any component could be named like this, this is the
         // best check we can do.
-        foreach(Component *c, components) {
+        foreach(Component *c, m_graphicsScene->components()) {
             if(c->label().startsWith("Sim")) {
                 foundSimulationProfile = true;
             }
@@ -913,6 +920,27 @@ namespace Caneda
             return false;
         }
 
+        //***********************************************
+        // Check for duplicated component labels
+        //***********************************************
+        // Spice requires unique element names, so components sharing a
+        // label would silently produce a wrong netlist.
+        QStringList duplicateLabels = m_graphicsScene->duplicateComponentLabels();
+
+        if(!duplicateLabels.isEmpty()) {
+            DocumentViewManager *manager = DocumentViewManager::instance();
+            IView *view = manager->currentView();
+
+            MessageWidget *dialog = new MessageWidget(tr("Duplicated component labels: %1")
+                                                      .arg(duplicateLabels.join(", ")),
+                                                      view->toWidget());
+            dialog->setMessageType(MessageWidget::Error);
+            dialog->setIcon(Caneda::icon("dialog-error"));
+            dialog->show();
+
+            return false;
+        }
+
         // Default return value
         return true;
     }
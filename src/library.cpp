@@ -22,17 +22,27 @@
 
 #include "fileformats.h"
 #include "global.h"
+#include "librarycache.h"
 #include "settings.h"
 #include "xmlutilities.h"
 
 #include <QByteArray>
+#include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QFileSystemWatcher>
 #include <QMessageBox>
 #include <QPainter>
 #include <QPixmapCache>
+#include <QRegularExpression>
+#include <QSet>
 #include <QString>
 #include <QTextStream>
+#include <QTimer>
+#include <QtConcurrent>
+#include <QtMath>
+
+#include <cmath>
 
 namespace Caneda
 {
@@ -43,24 +53,165 @@ namespace Caneda
     Library::Library(QString libraryPath, QObject *parent) :
         QObject(parent),
         m_libraryName(QFileInfo(libraryPath).baseName()),
-        m_libraryPath(libraryPath)
+        m_libraryPath(libraryPath),
+        m_cache(nullptr),
+        m_watcher(nullptr)
+    {
+        // Editors usually save a file in several steps (or several files at
+        // once), so changes are coalesced before reloading
+        m_reloadTimer = new QTimer(this);
+        m_reloadTimer->setSingleShot(true);
+        m_reloadTimer->setInterval(200);
+        connect(m_reloadTimer, SIGNAL(timeout()), this, SLOT(reloadChangedComponents()));
+    }
+
+    //! \brief Destructor.
+    Library::~Library()
     {
+        delete m_cache;
     }
 
-    //! \brief Returns the shared data of component from given name.
-    ComponentDataPtr Library::component(const QString& name) const
+    /*!
+     * \brief Functor used to parse a single symbol file in a worker thread.
+     *
+     * The component data is returned to the caller, which is in charge of
+     * creating its symbol drawing with createSymbol() and registering it
+     * from the gui thread.
+     */
+    struct ComponentFileLoader
+    {
+        //! Result of parsing a symbol file.
+        struct Result
+        {
+            ComponentData *component;
+            QString filePath;
+            QString errorString;
+            //! Xml data of the symbol paintings, see createSymbol().
+            QStringList symbolPaintings;
+        };
+
+        typedef Result result_type;
+
+        explicit ComponentFileLoader(const QString &libraryName) : m_libraryName(libraryName) {}
+
+        Result operator()(const QString &filePath) const
+        {
+            Result result;
+            result.filePath = filePath;
+            result.component = new ComponentData();
+            result.component->library = Caneda::internString(m_libraryName);
+            result.component->filename = filePath;
+
+            FormatXmlSymbol format(result.component);
+            if(!format.load()) {
+                result.errorString = format.errorString();
+                delete result.component;
+                result.component = nullptr;
+            }
+            else {
+                result.symbolPaintings = format.symbolPaintings();
+            }
+
+            return result;
+        }
+
+        //! \brief Creates the symbol drawing of a parsed component, from the gui thread.
+        static void createSymbol(const Result &result)
+        {
+            result.component->symbol = FormatXmlSymbol::symbolPath(result.symbolPaintings);
+        }
+
+        QString m_libraryName;
+    };
+
+    /*!
+     * \brief Returns the shared data of component from given name.
+     *
+     * If the component was not used before, its data is materialized here,
+     * either from the library cache or by parsing its symbol file.
+     */
+    ComponentDataPtr Library::component(const QString& name)
     {
-        return m_componentHash.contains(name) ?
-            m_componentHash[name] : ComponentDataPtr();
+        if(m_componentHash.contains(name)) {
+            return m_componentHash[name];
+        }
+
+        if(!m_componentIndex.contains(name)) {
+            return ComponentDataPtr();
+        }
+
+        const ComponentIndex index = m_componentIndex[name];
+        ComponentData *component = nullptr;
+        if(m_cache) {
+            component = m_cache->component(QFileInfo(index.filePath), libraryName());
+        }
+
+        if(!component) {
+            // The cache is not available or outdated, parse the symbol file
+            ComponentFileLoader::Result result = ComponentFileLoader(libraryName())(index.filePath);
+            if(!result.component) {
+                qWarning() << "Parsing component data file" << result.filePath
+                           << "failed:" << result.errorString;
+                return ComponentDataPtr();
+            }
+            ComponentFileLoader::createSymbol(result);
+            component = result.component;
+        }
+
+        return registerComponent(component);
+    }
+
+    //! \brief Returns the display text of a component without loading it.
+    QString Library::componentDisplayText(const QString& name) const
+    {
+        return m_componentIndex.value(name).displayText;
+    }
+
+    //! \brief Returns the search keywords of a component without loading it.
+    QString Library::componentKeywords(const QString& name) const
+    {
+        return m_componentIndex.value(name).keywords;
+    }
+
+    //! \brief Returns the symbol file path of a component without loading it.
+    QString Library::componentFilePath(const QString& name) const
+    {
+        return m_componentIndex.value(name).filePath;
+    }
+
+    /*!
+     * \brief Returns the compiled data of a component without loading it.
+     *
+     * The data may be decoded from a worker thread, for example with
+     * LibraryCache::decompileSymbol().
+     *
+     * \sa LibraryCache::compiledData()
+     */
+    QByteArray Library::componentCompiledData(const QString& name) const
+    {
+        if(!m_cache || !m_componentIndex.contains(name)) {
+            return QByteArray();
+        }
+
+        return m_cache->compiledData(QFileInfo(m_componentIndex[name].filePath).fileName());
     }
 
-    //! \brief Loads the library's components and its translated name.
+    /*!
+     * \brief Loads the library's components and its translated name.
+     *
+     * All paths are resolved against the library path (the process current
+     * directory is never changed). Components are first looked up in the
+     * precompiled LibraryCache, where only its index is read. Those
+     * components are materialized later, on demand, by component(). Only the
+     * symbol files missing from the cache or modified since it was built are
+     * parsed, concurrently on the global thread pool. Once all files are
+     * parsed, the cache is updated and the parsed components are registered
+     * in a single pass from the calling (gui) thread.
+     */
     bool Library::loadLibrary()
     {
-        // Go to base library dir
-        QString current = QDir::currentPath();
-        if(!QDir::setCurrent(m_libraryPath)) {
-            QDir::setCurrent(current);
+        QDir libraryDir(m_libraryPath);
+        if(!libraryDir.exists()) {
             return false;
         }
 
@@ -69,7 +220,7 @@ namespace Caneda
         // This file is necessary to hold the library names in
         // different languages. In this file isn't present, the
         // default library name is chosen (base dir).
-        QFile file("translations.xml");
+        QFile file(libraryDir.filePath("translations.xml"));
         if(file.open(QIODevice::ReadOnly)) {
             // Read the translations file
             QTextStream in(&file);
@@ -117,42 +268,284 @@ namespace Caneda
 
         }
 
-        QDir libraryPath(m_libraryPath);
-        QStringList componentsList = libraryPath.entryList(QStringList("*.xsym"));  // Filter only component files
-        foreach (const QString &componentPath, componentsList) {
-            // Read all components in the library path
-            ComponentData *component = new ComponentData();
-            component->library = libraryName();
-            component->filename = componentPath;
+        // Index all components in the library path, from the cache if possible
+        QStringList componentFiles = libraryDir.entryList(QStringList("*.xsym"));  // Filter only component files
+        QStringList componentsList;
+
+        delete m_cache;
+        m_cache = new LibraryCache(m_libraryPath);
+        m_cache->load();
+        foreach(const QString &componentFile, componentFiles) {
+            QFileInfo info(libraryDir.absoluteFilePath(componentFile));
+            ComponentIndex index;
+            index.filePath = info.absoluteFilePath();
+
+            QString name;
+            if(m_cache->lookup(info, &name, &index.displayText, &index.keywords)) {
+                if(!m_componentIndex.contains(name)) {
+                    m_componentIndex.insert(name, index);
+                }
+            }
+            else {
+                componentsList << index.filePath;
+            }
+        }
 
-            FormatXmlSymbol format(component, this);
-            readOk = readOk & format.load();
+        // Parse the remaining components
+        QList<ComponentFileLoader::Result> results =
+                QtConcurrent::blockingMapped<QList<ComponentFileLoader::Result> >(componentsList,
+                                                                                ComponentFileLoader(libraryName()));
 
-            if(!readOk) {
+        foreach(const ComponentFileLoader::Result &result, results) {
+            if(!result.component) {
+                readOk = false;
                 QMessageBox::warning(nullptr, QObject::tr("Error"),
-                                     QObject::tr("Parsing component data file %1 failed")
-                                     .arg(QFileInfo(componentPath).absoluteFilePath()));
+                                     QObject::tr("Parsing component data file %1 failed\n%2")
+                                     .arg(result.filePath).arg(result.errorString));
+                continue;
             }
-            else {
-                // Register component's data
-                if(!m_componentHash.contains(component->name)) {
-                    ComponentDataPtr componentDataPtr(component);
-                    m_componentHash.insert(component->name, componentDataPtr);
-                }
+
+            ComponentFileLoader::createSymbol(result);
+            ComponentData *component = result.component;
+            QString keywords = searchKeywords(component);
+            m_cache->insert(QFileInfo(result.filePath), component, keywords);
+
+            // Register the component's data, as it is already loaded
+            if(m_componentIndex.contains(component->name)) {
+                delete component;
+                continue;
             }
+
+            ComponentIndex index;
+            index.displayText = component->displayText;
+            index.keywords = keywords;
+            index.filePath = result.filePath;
+            m_componentIndex.insert(component->name, index);
+            registerComponent(component);
+        }
+
+        // Update the cache, dropping removed symbol files
+        m_cache->retain(componentFiles);
+        if(m_cache->isModified()) {
+            m_cache->save();
         }
 
-        QDir::setCurrent(current);
+        watchLibrary(componentFiles);
+
         return readOk;
     }
 
-    //! \brief Removes the component from library.
+    /*!
+     * \brief Reloads the symbol files changed since they were last loaded.
+     *
+     * This slot is called (through a coalescing timer) when the library
+     * directory or any of its symbol files change. The library cache is used
+     * to find the changed files, as its entries are validated against each
+     * symbol file's size and modification time. Only those files are parsed
+     * again, and the components removed from the directory are dropped.
+     *
+     * Components already in use are replaced in the component hash and their
+     * symbols updated in the LibraryManager, which in turn notifies the
+     * scenes holding them.
+     *
+     * \sa LibraryManager::componentChanged(), LibraryManager::libraryChanged()
+     */
+    void Library::reloadChangedComponents()
+    {
+        QDir libraryDir(m_libraryPath);
+        if(!m_cache || !libraryDir.exists()) {
+            return;
+        }
+
+        QStringList componentFiles = libraryDir.entryList(QStringList("*.xsym"));
+        QStringList changedFiles;
+        QSet<QString> existingPaths;
+        foreach(const QString &componentFile, componentFiles) {
+            QFileInfo info(libraryDir.absoluteFilePath(componentFile));
+            existingPaths << info.absoluteFilePath();
+
+            QString name, displayText, keywords;
+            if(!m_cache->lookup(info, &name, &displayText, &keywords)) {
+                changedFiles << info.absoluteFilePath();
+            }
+        }
+
+        // Drop the components whose symbol file was removed
+        bool changed = false;
+        foreach(const QString &name, m_componentIndex.keys()) {
+            if(!existingPaths.contains(m_componentIndex[name].filePath)) {
+                removeComponent(name);
+                changed = true;
+            }
+        }
+
+        QList<ComponentFileLoader::Result> results =
+                QtConcurrent::blockingMapped<QList<ComponentFileLoader::Result> >(changedFiles,
+                                                                                ComponentFileLoader(libraryName()));
+
+        QStringList updatedComponents;
+        foreach(const ComponentFileLoader::Result &result, results) {
+            if(!result.component) {
+                // The file may be still being written, it will be parsed
+                // again on its next change
+                qWarning() << "Parsing component data file" << result.filePath
+                           << "failed:" << result.errorString;
+                continue;
+            }
+
+            ComponentFileLoader::createSymbol(result);
+            ComponentData *component = result.component;
+            QString keywords = searchKeywords(component);
+            m_cache->insert(QFileInfo(result.filePath), component, keywords);
+
+            // The component may have been renamed inside its file
+            foreach(const QString &name, m_componentIndex.keys()) {
+                if(name != component->name && m_componentIndex[name].filePath == result.filePath) {
+                    removeComponent(name);
+                }
+            }
+
+            ComponentIndex index;
+            index.displayText = component->displayText;
+            index.keywords = keywords;
+            index.filePath = result.filePath;
+            m_componentIndex.insert(component->name, index);
+            changed = true;
+
+            // The symbol must be replaced if registered, even if the
+            // component is not in use anymore (for example, when a removed
+            // symbol file is added again), as registering does not replace
+            // existing symbols.
+            LibraryManager *manager = LibraryManager::instance();
+            if(manager->isRegistered(component->name, libraryName())) {
+                manager->updateComponent(component->name, libraryName(), component->symbol);
+                updatedComponents << component->name;
+            }
+
+            // Only the components in use must be replaced, the rest are
+            // materialized on demand from the updated cache
+            if(m_componentHash.contains(component->name)) {
+                m_componentHash.insert(component->name, ComponentDataPtr(component));
+            }
+            else {
+                delete component;
+            }
+        }
+
+        m_cache->retain(componentFiles);
+        if(m_cache->isModified()) {
+            m_cache->save();
+        }
+
+        watchLibrary(componentFiles);
+
+        LibraryManager *manager = LibraryManager::instance();
+        foreach(const QString &name, updatedComponents) {
+            emit manager->componentChanged(name, libraryName());
+        }
+
+        if(changed) {
+            emit manager->libraryChanged(libraryName());
+        }
+    }
+
+    /*!
+     * \brief Watches the library directory and its symbol files for changes.
+     *
+     * The directory watch reports symbol files being added, removed, renamed
+     * or replaced (as most editors save them), and the file watches report
+     * symbol files rewritten in place, which do not change the directory on
+     * every platform. In both cases, the changed files are then found by
+     * reloadChangedComponents(), comparing each file's modification time and
+     * size with the library cache.
+     *
+     * Only the paths not watched yet are added, as replaced or removed files
+     * drop their watches. Existing watches are never removed and added
+     * again, which would be expensive for large libraries.
+     *
+     * \param componentFiles Symbol files currently in the library directory.
+     */
+    void Library::watchLibrary(const QStringList &componentFiles)
+    {
+        if(!m_watcher) {
+            m_watcher = new QFileSystemWatcher(this);
+            connect(m_watcher, SIGNAL(directoryChanged(QString)), m_reloadTimer, SLOT(start()));
+            connect(m_watcher, SIGNAL(fileChanged(QString)), m_reloadTimer, SLOT(start()));
+        }
+
+        QDir libraryDir(m_libraryPath);
+        QStringList paths;
+
+        // The directory is not watched anymore if it was removed meanwhile
+        if(!m_watcher->directories().contains(libraryDir.absolutePath())) {
+            paths << libraryDir.absolutePath();
+        }
+
+        const QStringList watchedFiles = m_watcher->files();
+        QSet<QString> watched(watchedFiles.begin(), watchedFiles.end());
+        foreach(const QString &componentFile, componentFiles) {
+            QString filePath = libraryDir.absoluteFilePath(componentFile);
+            if(!watched.contains(filePath)) {
+                paths << filePath;
+            }
+        }
+
+        if(!paths.isEmpty()) {
+            m_watcher->addPaths(paths);
+        }
+    }
+
+    /*!
+     * \brief Returns the text used to search a component, apart from its name.
+     *
+     * This includes the display text, the description, the model types and
+     * the identifiers used in the models (for example, the spice model
+     * names), skipping model commands like %label or %port.
+     */
+    QString Library::searchKeywords(const ComponentData *component)
+    {
+        QStringList keywords;
+        keywords << component->displayText << component->description;
+
+        QRegularExpression identifier("(?<![%\\w])[A-Za-z_]\\w+");
+        for(QMap<QString, QString>::const_iterator it = component->models.constBegin();
+                it != component->models.constEnd(); ++it) {
+            keywords << it.key();
+
+            QRegularExpressionMatchIterator matches = identifier.globalMatch(it.value());
+            while(matches.hasNext()) {
+                keywords << matches.next().captured();
+            }
+        }
+
+        keywords.removeDuplicates();
+        return keywords.join(" ");
+    }
+
+    //! \brief Registers a materialized component and its symbol.
+    ComponentDataPtr Library::registerComponent(ComponentData *component)
+    {
+        LibraryManager::instance()->registerComponent(component->name, component->library, component->symbol);
+
+        ComponentDataPtr componentDataPtr(component);
+        m_componentHash.insert(component->name, componentDataPtr);
+        return componentDataPtr;
+    }
+
+    /*!
+     * \brief Removes the component from library.
+     *
+     * The symbol registered in the LibraryManager is kept, as components in
+     * use may still draw it. If the component is added again, its symbol is
+     * replaced by reloadChangedComponents().
+     */
     bool Library::removeComponent(QString componentName)
     {
-        if(!m_componentHash.contains(componentName)) {
+        if(!m_componentIndex.contains(componentName)) {
             return false;
         }
 
+        m_componentIndex.remove(componentName);
         m_componentHash.remove(componentName);
         return true;
     }
@@ -164,6 +557,16 @@ namespace Caneda
     //! \brief Constructor.
     LibraryManager::LibraryManager(QObject *parent) : QObject(parent)
     {
+        // Leave room for the symbols atlas (several zoom levels and colors
+        // per symbol). The limit is given in kilobytes.
+        if(QPixmapCache::cacheLimit() < 65536) {
+            QPixmapCache::setCacheLimit(65536);
+        }
+
+        // The symbol pens are read once here, instead of on every paint
+        updateSymbolStyle();
+        connect(Settings::instance(), &Settings::currentValueChanged,
+                this, &LibraryManager::updateSymbolStyle);
     }
 
     //! \copydoc MainWindow::instance()
@@ -179,11 +582,8 @@ namespace Caneda
     //! \brief Create library indicated by path \a libPath.
     bool LibraryManager::newLibrary(const QString& libPath)
     {
-        // Go to base dir
-        QString libParentPath = QFileInfo(libPath).dir().absolutePath();
-        QString current = QDir::currentPath();
-        if(!QDir::setCurrent(libParentPath)) {
-            (void) QDir::setCurrent(current);
+        // Check the base dir exists
+        if(!QFileInfo(libPath).dir().exists()) {
             return false;
         }
 
@@ -286,6 +686,40 @@ namespace Caneda
         m_dataHash[symbol_id] = content;
     }
 
+    /*!
+     * \brief Returns true if the symbol of a component is registered.
+     *
+     * \param compName Component name, used as part of the key
+     * \param libName Library name, used as part of the key
+     *
+     * \sa registerComponent(), updateComponent()
+     */
+    bool LibraryManager::isRegistered(const QString &compName, const QString &libName) const
+    {
+        return m_dataHash.contains(compName + ":" + libName);
+    }
+
+    /*!
+     * \brief Replaces an already registered component symbol.
+     *
+     * This method is used when a symbol file changes on disk. The pixmaps
+     * cached for the previous symbol are left to expire from the
+     * QPixmapCache, as the symbol generation is part of the pixmap keys.
+     *
+     * \param compName Component name, used as part of the key
+     * \param libName Library name, used as part of the key
+     * \param content QPainterPath containing the new symbol
+     *
+     * \sa registerComponent(), pixmapCache()
+     */
+    void LibraryManager::updateComponent(const QString &compName, const QString &libName, const QPainterPath& content)
+    {
+        QString symbol_id = compName + ":" + libName;
+
+        m_dataHash[symbol_id] = content;
+        ++m_symbolGenerations[symbol_id];
+    }
+
     /*!
      * \brief Returns the symbol (QPainterPath) of a component corresponding to
      * a key.
@@ -295,6 +729,9 @@ namespace Caneda
      *
      * \param compName Component name, used as part of the key
      * \param libName Library name, used as part of the key
+     * If the component was not used before, it is loaded from its library
+     * (and its symbol registered) first.
+     *
      * \return QPainterPath corresponding to the symbol
      *
      * \sa registerComponent(), pixmapCache()
@@ -302,7 +739,12 @@ namespace Caneda
     QPainterPath LibraryManager::symbolCache(const QString &compName, const QString &libName)
     {
         QString symbol_id = compName + ":" + libName;
-        return m_dataHash[symbol_id];
+
+        if(!m_dataHash.contains(symbol_id)) {
+            componentData(compName, libName);
+        }
+
+        return m_dataHash.value(symbol_id);
     }
 
     /*!
@@ -312,42 +754,102 @@ namespace Caneda
      * Each component's key is saved in the form "componentName:libraryName" to
      * allow for different libraries to have components with the same name.
      *
+     * The pixmap is rendered for the nearest zoom bucket (a power of two
+     * between 1/4 and 4) to the requested \a zoom, and cached per bucket and
+     * pen. The returned pixmap always covers the symbol's bounding rect
+     * (adjusted one unit on each side to avoid clipping), so it must be drawn
+     * into that rect in item coordinates. If \a zoom is out of the atlas
+     * range, a null pixmap is returned and the caller should draw the symbol
+     * path instead.
+     *
      * \param compName Component name, used as part of the key
      * \param libName Library name, used as part of the key
+     * \param zoom The current zoom level (level of detail) of the painter
+     * \param selected Whether to use the selection color instead of the line
+     * color
      * \return QPixmap corresponding to the symbol
      *
-     * \sa registerComponent(), symbolCache()
+     * \sa registerComponent(), symbolCache(), symbolPen()
      */
-    const QPixmap LibraryManager::pixmapCache(const QString &compName, const QString &libName)
+    const QPixmap LibraryManager::pixmapCache(const QString &compName, const QString &libName,
+                                              qreal zoom, bool selected)
     {
+        // Zoom buckets as powers of two, from 1/4 to 4
+        const int minBucket = -2;
+        const int maxBucket = 2;
+
+        if(zoom <= 0) {
+            return QPixmap();
+        }
+
+        int bucket = qRound(std::log2(zoom));
+        if(bucket < minBucket || bucket > maxBucket) {
+            return QPixmap();
+        }
+        const qreal bucketZoom = std::pow(2.0, bucket);
+
         QString symbol_id = compName + ":" + libName;
+        QString pixmap_id = m_pixmapKeyPrefixes[selected] + symbol_id +
+                '#' + QString::number(m_symbolGenerations.value(symbol_id)) +
+                '@' + QString::number(bucket);
         QPixmap pix;
 
-        if(!QPixmapCache::find(symbol_id, &pix)) {
+        if(!QPixmapCache::find(pixmap_id, &pix)) {
 
-            QPainterPath data = m_dataHash[symbol_id];
+            QPainterPath data = symbolCache(compName, libName);
             QRect rect =  data.boundingRect().toRect();
             rect.adjust(-1.0, -1.0, 1.0, 1.0); // Adjust rect to avoid clipping due to rounding (rectF -> rect)
-            pix = QPixmap(rect.size());
+            pix = QPixmap(qCeil(rect.width() * bucketZoom), qCeil(rect.height() * bucketZoom));
             pix.fill(Qt::transparent);
 
             QPainter painter(&pix);
             painter.setRenderHints(Caneda::DefaulRenderHints);
+            painter.setPen(m_symbolPens[selected]);
 
-            Settings *settings = Settings::instance();
-            painter.setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                settings->currentValue("gui/lineWidth").toInt()));
-
+            painter.scale(bucketZoom, bucketZoom);
             QPointF offset = -rect.topLeft(); // (0,0)-topLeft()
             painter.translate(offset);
             painter.drawPath(data);
 
-            QPixmapCache::insert(symbol_id, pix);
+            QPixmapCache::insert(pixmap_id, pix);
         }
 
         return pix;
     }
 
+    /*!
+     * \brief Updates the symbol pens and pixmap keys from the settings.
+     *
+     * This is called when a setting changes, so that painting the symbols
+     * does not need to query the settings. The pixmaps cached with the
+     * previous pens are no longer found, as their keys include the pen.
+     *
+     * \param key Setting that changed, or an empty string to update all.
+     *
+     * \sa Settings::currentValueChanged()
+     */
+    void LibraryManager::updateSymbolStyle(const QString &key)
+    {
+        if(!key.isEmpty() && key != "gui/lineColor" &&
+                key != "gui/selectionColor" && key != "gui/lineWidth") {
+            return;
+        }
+
+        Settings *settings = Settings::instance();
+        const QColor colors[2] = {
+            settings->currentValue("gui/lineColor").value<QColor>(),
+            settings->currentValue("gui/selectionColor").value<QColor>()
+        };
+        const int width = settings->currentValue("gui/lineWidth").toInt();
+
+        for(int i = 0; i < 2; ++i) {
+            m_symbolPens[i] = QPen(colors[i], width);
+            m_outlinePens[i] = QPen(colors[i], 0);
+            m_pixmapKeyPrefixes[i] = colors[i].name(QColor::HexArgb) + ':' +
+                    QString::number(width) + '|';
+        }
+    }
+
     /*!
      * \brief Returns default component data given its name and library.
      *
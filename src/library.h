@@ -24,9 +24,17 @@
 #include "component.h"
 
 #include <QHash>
+#include <QPen>
+
+// Forward declarations
+class QFileSystemWatcher;
+class QTimer;
 
 namespace Caneda
 {
+    // Forward declarations
+    class LibraryCache;
+
     /*!
      * \brief This class represents an individual library unit.
      *
@@ -36,6 +44,18 @@ namespace Caneda
      * component referencing, etc.). This class also handles the loading of all
      * components in a library at once.
      *
+     * Loading a library only builds a lightweight index of its components
+     * (name, display text, search keywords and symbol file) from the
+     * LibraryCache. The full
+     * ComponentData of a component is materialized on its first use through
+     * component(), so memory usage scales with the components actually used.
+     *
+     * Once loaded, the library directory and its symbol files are watched
+     * for changes. When symbol files are added, modified or removed, only
+     * those files are parsed again (see reloadChangedComponents()) and the
+     * LibraryManager is notified, so placed components can be refreshed
+     * without restarting the application.
+     *
      * \sa LibraryManager, Component
      */
     class Library : public QObject
@@ -44,26 +64,59 @@ namespace Caneda
 
     public:
         explicit Library(QString libraryPath, QObject *parent = nullptr);
+        ~Library() override;
 
         //! Returns library name.
         QString libraryName() const { return m_libraryName; }
         //! Returns library filename.
         QString libraryPath() const { return m_libraryPath; }
 
-        ComponentDataPtr component(const QString& name) const;
+        ComponentDataPtr component(const QString& name);
+        QString componentDisplayText(const QString& name) const;
+        QString componentKeywords(const QString& name) const;
+        QString componentFilePath(const QString& name) const;
+        QByteArray componentCompiledData(const QString& name) const;
+
+        static QString searchKeywords(const ComponentData *component);
         //! Returns the components list.
-        const QList<QString> componentsList() const { return m_componentHash.keys(); }
+        const QList<QString> componentsList() const { return m_componentIndex.keys(); }
 
         bool loadLibrary();
         bool removeComponent(QString componentName);
 
+    private Q_SLOTS:
+        void reloadChangedComponents();
+
     private:
+        void watchLibrary(const QStringList &componentFiles);
+
         //! Library name. If not specified in "translations.xml", it is the base dir name.
         QString m_libraryName;
         //! Library full path.
         QString m_libraryPath;
 
+        ComponentDataPtr registerComponent(ComponentData *component);
+
+        //! \brief Lightweight index entry of a library component.
+        struct ComponentIndex
+        {
+            QString displayText;
+            QString keywords;
+            QString filePath;
+        };
+
+        //! Index of all components in the library, loaded or not.
+        QHash<QString, ComponentIndex> m_componentIndex;
+        //! Components already materialized.
         QHash<QString, ComponentDataPtr> m_componentHash;
+
+        //! Precompiled library cache, used to materialize components.
+        LibraryCache *m_cache;
+
+        //! Watcher of the library directory and symbol files.
+        QFileSystemWatcher *m_watcher;
+        //! Timer used to coalesce several file changes in one reload.
+        QTimer *m_reloadTimer;
     };
 
     /*!
@@ -81,6 +134,11 @@ namespace Caneda
      * for painting components is created only once (independently of the
      * number of components used by the user in the final schematic).
      *
+     * Symbol pixmaps are kept as an atlas of a few zoom levels (powers of two
+     * around 1:1) for both the normal and the selected colors. In this way,
+     * components can be painted from a pixmap at any common zoom level,
+     * instead of redrawing their paths.
+     *
      * This class is a singleton class and its only static instance (returned
      * by instance()) is to be used.
      *
@@ -106,11 +164,29 @@ namespace Caneda
         // Symbol caching related methods
         void registerComponent(const QString &compName, const QString &libName, const QPainterPath& content);
 
+        bool isRegistered(const QString &compName, const QString &libName) const;
+        void updateComponent(const QString &compName, const QString &libName, const QPainterPath& content);
+
         QPainterPath symbolCache(const QString &compName, const QString &libName);
-        const QPixmap pixmapCache(const QString &compName, const QString &libName);
+        const QPixmap pixmapCache(const QString &compName, const QString &libName,
+                                  qreal zoom = 1.0, bool selected = false);
+
+        //! Returns the pen used to draw the symbols, as set in the settings.
+        const QPen& symbolPen(bool selected) const { return m_symbolPens[selected]; }
+        //! Returns the cosmetic pen used to draw the symbols outlines.
+        const QPen& outlinePen(bool selected) const { return m_outlinePens[selected]; }
 
         ComponentDataPtr componentData(QString name, QString library);
 
+    Q_SIGNALS:
+        //! \brief Emitted when a component was reloaded from its library.
+        void componentChanged(const QString &compName, const QString &libName);
+        //! \brief Emitted when components were added, modified or removed from a library.
+        void libraryChanged(const QString &libName);
+
+    private Q_SLOTS:
+        void updateSymbolStyle(const QString &key = QString());
+
     private:
         explicit LibraryManager(QObject *parent = nullptr);
 
@@ -119,6 +195,15 @@ namespace Caneda
 
         //! Symbol cache (hash table) to hold symbol's QPainterPaths.
         QHash<QString, QPainterPath> m_dataHash;
+        //! Number of times each symbol was updated, used to invalidate pixmaps.
+        QHash<QString, int> m_symbolGenerations;
+
+        //! Symbol pens, unselected and selected.
+        QPen m_symbolPens[2];
+        //! Symbol outline pens, unselected and selected.
+        QPen m_outlinePens[2];
+        //! Prefix of the pixmap cache keys for each pen, unselected and selected.
+        QString m_pixmapKeyPrefixes[2];
     };
 
 } // namespace Caneda
@@ -0,0 +1,471 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "librarycache.h"
+
+#include "global.h"
+#include "port.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+namespace Caneda
+{
+    //! \brief Magic number identifying a library cache file ("CNDL").
+    static const quint32 LibraryCacheMagic = 0x434E444C;
+    //! \brief Version of the library cache format. Increment on format changes.
+    static const quint32 LibraryCacheVersion = 3;
+
+    //! \brief Constructs the cache of the library located at \a libraryPath.
+    LibraryCache::LibraryCache(const QString &libraryPath) :
+        m_libraryPath(QDir(libraryPath).absolutePath()),
+        m_map(nullptr),
+        m_mapSize(0),
+        m_modified(false)
+    {
+    }
+
+    //! \brief Destructor.
+    LibraryCache::~LibraryCache()
+    {
+        unmap();
+    }
+
+    /*!
+     * \brief Maps the cache file and reads its index.
+     *
+     * The cache is discarded if it was generated by a different Caneda
+     * version, for a different locale (as display texts are translated) or if
+     * it is corrupted. Compiled components are not read here, but later on
+     * demand by component().
+     *
+     * \return True if a valid cache was found, false otherwise.
+     */
+    bool LibraryCache::load()
+    {
+        unmap();
+        m_index.clear();
+        m_modified = false;
+
+        m_file.setFileName(cacheFileName());
+        if(!m_file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        m_mapSize = m_file.size();
+        m_map = m_file.map(0, m_mapSize);
+        if(!m_map) {
+            m_file.close();
+            return false;
+        }
+
+        QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(m_map), m_mapSize);
+        QDataStream stream(raw);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic;
+        quint32 version;
+        QString canedaVersion;
+        QString locale;
+        stream >> magic >> version >> canedaVersion >> locale;
+
+        if(magic != LibraryCacheMagic || version != LibraryCacheVersion ||
+                canedaVersion != Caneda::version() || locale != Caneda::localePrefix()) {
+            unmap();
+            return false;
+        }
+
+        quint32 count;
+        stream >> count;
+
+        QList<QString> names;
+        QList<Entry> entries;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QString name;
+            Entry entry;
+            stream >> name >> entry.name >> entry.displayText >> entry.keywords
+                   >> entry.modified >> entry.size >> entry.offset >> entry.length;
+            names << name;
+            entries << entry;
+        }
+
+        if(stream.status() != QDataStream::Ok) {
+            unmap();
+            return false;
+        }
+
+        // Compiled data offsets are stored relative to the end of the index
+        const qint64 dataStart = stream.device()->pos();
+        for(int i = 0; i < entries.size(); ++i) {
+            Entry entry = entries.at(i);
+            entry.offset += dataStart;
+            if(entry.offset < dataStart || entry.offset + entry.length > m_mapSize) {
+                unmap();
+                m_index.clear();
+                return false;
+            }
+            m_index.insert(names.at(i), entry);
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Writes the cache file.
+     *
+     * The file is written atomically, so a concurrent Caneda instance never
+     * reads a partially written cache. Once written, the new file is mapped
+     * again, so that compiled data is not kept in memory.
+     */
+    bool LibraryCache::save()
+    {
+        QDir().mkpath(QFileInfo(cacheFileName()).absolutePath());
+
+        // Collect all compiled data before unmapping the old file
+        QList<QString> names = m_index.keys();
+        QList<QByteArray> blobs;
+        foreach(const QString &name, names) {
+            blobs << entryData(m_index.value(name));
+        }
+
+        QSaveFile file(cacheFileName());
+        if(!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << LibraryCacheMagic << LibraryCacheVersion << Caneda::version() << Caneda::localePrefix();
+        stream << quint32(names.size());
+
+        qint64 offset = 0;
+        for(int i = 0; i < names.size(); ++i) {
+            const Entry &entry = m_index[names.at(i)];
+            qint64 length = blobs.at(i).size();
+            stream << names.at(i) << entry.name << entry.displayText << entry.keywords
+                   << entry.modified << entry.size << offset << length;
+            offset += length;
+        }
+
+        foreach(const QByteArray &blob, blobs) {
+            stream.writeRawData(blob.constData(), blob.size());
+        }
+
+        if(stream.status() != QDataStream::Ok) {
+            file.cancelWriting();
+            return false;
+        }
+
+        // The old file must not be mapped while being replaced (renaming
+        // over a mapped file fails on Windows). The compiled data is kept
+        // in memory meanwhile, as the index does not point to the old file
+        // anymore.
+        unmap();
+        for(int i = 0; i < names.size(); ++i) {
+            Entry &entry = m_index[names.at(i)];
+            entry.data = blobs.at(i);
+            entry.offset = -1;
+            entry.length = entry.data.size();
+        }
+
+        if(!file.commit()) {
+            return false;
+        }
+
+        // Map the new file, keeping the in-memory index if it cannot be read
+        const QHash<QString, Entry> index = m_index;
+        if(!load()) {
+            m_index = index;
+            m_modified = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Returns the indexed name, display text and search keywords of a
+     * symbol file.
+     *
+     * This method does not decode the compiled component.
+     *
+     * \param symbolFile The symbol file (*.xsym) to look for.
+     * \param name Returns the component name.
+     * \param displayText Returns the component display text.
+     * \param keywords Returns the component search keywords.
+     * \return True if the cache holds an up to date entry for \a symbolFile.
+     */
+    bool LibraryCache::lookup(const QFileInfo &symbolFile, QString *name,
+                              QString *displayText, QString *keywords) const
+    {
+        if(!m_index.contains(symbolFile.fileName())) {
+            return false;
+        }
+
+        const Entry &entry = m_index[symbolFile.fileName()];
+        if(!isValid(entry, symbolFile)) {
+            return false;
+        }
+
+        *name = entry.name;
+        *displayText = entry.displayText;
+        *keywords = entry.keywords;
+        return true;
+    }
+
+    /*!
+     * \brief Returns the cached component data of a symbol file.
+     *
+     * \param symbolFile The symbol file (*.xsym) to look for.
+     * \param libraryName The name of the library the component belongs to.
+     * \return A newly allocated ComponentData if the cache holds an up to date
+     * entry for \a symbolFile, nullptr otherwise.
+     */
+    ComponentData* LibraryCache::component(const QFileInfo &symbolFile, const QString &libraryName) const
+    {
+        if(!m_index.contains(symbolFile.fileName())) {
+            return nullptr;
+        }
+
+        const Entry &entry = m_index[symbolFile.fileName()];
+        if(!isValid(entry, symbolFile)) {
+            return nullptr;
+        }
+
+        ComponentData *component = decompile(entryData(entry));
+        if(component) {
+            component->library = Caneda::internString(libraryName);
+            component->filename = symbolFile.absoluteFilePath();
+        }
+
+        return component;
+    }
+
+    /*!
+     * \brief Returns the compiled data of a symbol file, as indexed.
+     *
+     * Unlike component(), the entry is not validated against the symbol file
+     * (the library validates all entries when indexing them) and it is not
+     * decoded, so that it can be decoded later from any thread, for example
+     * with decompileSymbol().
+     *
+     * \param symbolFileName The file name (without path) of the symbol file.
+     * \return The compiled data, or an empty array if there is no entry for
+     * \a symbolFileName.
+     */
+    QByteArray LibraryCache::compiledData(const QString &symbolFileName) const
+    {
+        if(!m_index.contains(symbolFileName)) {
+            return QByteArray();
+        }
+
+        return entryData(m_index[symbolFileName]);
+    }
+
+    //! \brief Adds or replaces the compiled data of \a symbolFile.
+    void LibraryCache::insert(const QFileInfo &symbolFile, const ComponentData *component,
+                              const QString &keywords)
+    {
+        Entry entry;
+        entry.name = component->name;
+        entry.displayText = component->displayText;
+        entry.keywords = keywords;
+        entry.modified = symbolFile.lastModified().toMSecsSinceEpoch();
+        entry.size = symbolFile.size();
+        entry.data = compile(component);
+        entry.offset = -1;
+        entry.length = entry.data.size();
+
+        m_index.insert(symbolFile.fileName(), entry);
+        m_modified = true;
+    }
+
+    //! \brief Removes all entries whose symbol file is not in \a symbolFiles.
+    void LibraryCache::retain(const QStringList &symbolFiles)
+    {
+        QSet<QString> existing(symbolFiles.begin(), symbolFiles.end());
+        foreach(const QString &name, m_index.keys()) {
+            if(!existing.contains(name)) {
+                m_index.remove(name);
+                m_modified = true;
+            }
+        }
+    }
+
+    /*!
+     * \brief Serializes a component into its binary (compiled) form.
+     *
+     * The library and filename are not stored, as they depend on where the
+     * library is loaded from.
+     *
+     * \sa decompile()
+     */
+    QByteArray LibraryCache::compile(const ComponentData *component)
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        stream << component->name << component->displayText
+               << component->labelPrefix << component->description
+               << component->symbol;
+
+        stream << quint32(component->ports.size());
+        foreach(const PortData *port, component->ports) {
+            stream << port->pos << port->name;
+        }
+
+        PropertyMap properties = component->properties->propertyMap();
+        stream << quint32(properties.size());
+        foreach(const Property &property, properties) {
+            stream << property.name() << property.value()
+                   << property.description() << property.isVisible();
+        }
+
+        stream << component->models;
+
+        return data;
+    }
+
+    /*!
+     * \brief Recreates a component from its binary (compiled) form.
+     *
+     * \return A newly allocated ComponentData, or nullptr if \a data is not
+     * valid.
+     *
+     * \sa compile()
+     */
+    ComponentData* LibraryCache::decompile(const QByteArray &data)
+    {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        ComponentData *component = new ComponentData();
+        stream >> component->name >> component->displayText
+               >> component->labelPrefix >> component->description
+               >> component->symbol;
+        component->name = Caneda::internString(component->name);
+        component->labelPrefix = Caneda::internString(component->labelPrefix);
+
+        quint32 portsCount;
+        stream >> portsCount;
+        for(quint32 i = 0; i < portsCount && stream.status() == QDataStream::Ok; ++i) {
+            QPointF pos;
+            QString name;
+            stream >> pos >> name;
+            component->ports << new PortData(pos, name);
+        }
+
+        quint32 propertiesCount;
+        stream >> propertiesCount;
+        PropertyMap properties;
+        for(quint32 i = 0; i < propertiesCount && stream.status() == QDataStream::Ok; ++i) {
+            QString name;
+            QString value;
+            QString description;
+            bool visible;
+            stream >> name >> value >> description >> visible;
+            properties.insert(name, Property(name, value, description, visible));
+        }
+        component->properties->setPropertyMap(properties);
+
+        stream >> component->models;
+
+        if(stream.status() != QDataStream::Ok) {
+            qDeleteAll(component->ports);
+            delete component;
+            return nullptr;
+        }
+
+        return component;
+    }
+
+    /*!
+     * \brief Decodes only the symbol drawing from compiled data.
+     *
+     * This does not create a ComponentData (nor its properties group), so it
+     * is cheap and may be called from worker threads.
+     *
+     * \return The symbol drawing, or an empty path if \a data is not valid.
+     *
+     * \sa compile(), decompile()
+     */
+    QPainterPath LibraryCache::decompileSymbol(const QByteArray &data)
+    {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        QString name;
+        QString displayText;
+        QString labelPrefix;
+        QString description;
+        QPainterPath symbol;
+        stream >> name >> displayText >> labelPrefix >> description >> symbol;
+
+        if(stream.status() != QDataStream::Ok) {
+            return QPainterPath();
+        }
+
+        return symbol;
+    }
+
+    //! \brief Returns true if \a entry is up to date with \a symbolFile.
+    bool LibraryCache::isValid(const Entry &entry, const QFileInfo &symbolFile) const
+    {
+        return entry.modified == symbolFile.lastModified().toMSecsSinceEpoch() &&
+                entry.size == symbolFile.size();
+    }
+
+    //! \brief Returns the compiled data of an entry.
+    QByteArray LibraryCache::entryData(const Entry &entry) const
+    {
+        if(entry.offset < 0) {
+            return entry.data;
+        }
+
+        return QByteArray(reinterpret_cast<const char*>(m_map + entry.offset), entry.length);
+    }
+
+    //! \brief Releases the mapped cache file, if any.
+    void LibraryCache::unmap()
+    {
+        if(m_map) {
+            m_file.unmap(m_map);
+            m_map = nullptr;
+        }
+
+        m_mapSize = 0;
+        m_file.close();
+    }
+
+    //! \brief Returns the cache file name, unique for each library path.
+    QString LibraryCache::cacheFileName() const
+    {
+        QByteArray hash = QCryptographicHash::hash(m_libraryPath.toUtf8(), QCryptographicHash::Sha1);
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                "/libraries/" + QString::fromLatin1(hash.toHex()) + ".cache";
+    }
+
+} // namespace Caneda
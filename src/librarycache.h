@@ -0,0 +1,113 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef LIBRARY_CACHE_H
+#define LIBRARY_CACHE_H
+
+#include "component.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+
+// Forward declarations
+class QFileInfo;
+
+namespace Caneda
+{
+    /*!
+     * \brief This class handles the precompiled (binary) cache of a library.
+     *
+     * Parsing every symbol file of a library on each start is expensive, as
+     * the xml data includes all translations, paintings, ports, properties and
+     * models. This class keeps a compiled copy of the ComponentData of every
+     * symbol in a library directory in a single binary file, stored in the
+     * user's cache directory.
+     *
+     * The cache file starts with an index holding, for each symbol file, its
+     * name, modification time and size, and the location of its compiled data.
+     * On load() the file is memory mapped and only the index is read, the
+     * components being decoded on demand by component(). The index also holds
+     * each component's name, display text and search keywords, which is all a
+     * library needs to list and search its components without decoding them
+     * (see lookup()). Each cache
+     * entry is validated against its symbol file, so that when a single symbol
+     * changes only that symbol must be parsed again and updated with insert().
+     *
+     * \sa Library, FormatXmlSymbol
+     */
+    class LibraryCache
+    {
+    public:
+        explicit LibraryCache(const QString &libraryPath);
+        ~LibraryCache();
+
+        bool load();
+        bool save();
+
+        bool lookup(const QFileInfo &symbolFile, QString *name,
+                    QString *displayText, QString *keywords) const;
+        ComponentData* component(const QFileInfo &symbolFile, const QString &libraryName) const;
+        QByteArray compiledData(const QString &symbolFileName) const;
+        void insert(const QFileInfo &symbolFile, const ComponentData *component,
+                    const QString &keywords);
+        void retain(const QStringList &symbolFiles);
+
+        //! Returns true if the cache was changed after load() and must be saved.
+        bool isModified() const { return m_modified; }
+
+        static QByteArray compile(const ComponentData *component);
+        static ComponentData* decompile(const QByteArray &data);
+        static QPainterPath decompileSymbol(const QByteArray &data);
+
+    private:
+        //! Index entry of a compiled symbol.
+        struct Entry
+        {
+            QString name;
+            QString displayText;
+            QString keywords;
+            qint64 modified;
+            qint64 size;
+            //! Offset of the compiled data in the mapped file (if not in \a data).
+            qint64 offset;
+            qint64 length;
+            //! Compiled data for entries added after load().
+            QByteArray data;
+        };
+
+        bool isValid(const Entry &entry, const QFileInfo &symbolFile) const;
+        QByteArray entryData(const Entry &entry) const;
+        void unmap();
+
+        QString cacheFileName() const;
+
+        QString m_libraryPath;
+        QHash<QString, Entry> m_index;
+
+        QFile m_file;
+        uchar *m_map;
+        qint64 m_mapSize;
+
+        bool m_modified;
+    };
+
+} // namespace Caneda
+
+#endif //LIBRARY_CACHE_H
@@ -22,6 +22,7 @@
 
 #include "aboutdialog.h"
 #include "actionmanager.h"
+#include "autosave.h"
 #include "documentviewmanager.h"
 #include "exportdialog.h"
 #include "filenewdialog.h"
@@ -167,6 +168,10 @@ namespace Caneda
         else {
             m_folderBrowser->setCurrentFolder(QDir::homePath());
         }
+
+        // Start autosaving, and offer to recover the documents of a
+        // previous session that was not closed properly
+        AutosaveManager::instance()->recover();
     }
 
     //! \brief Opens the file new dialog.
@@ -852,6 +857,7 @@ namespace Caneda
         // Update all document views to reflect the current settings.
         if(result == QDialog::Accepted) {
             DocumentViewManager::instance()->updateSettingsChanges();
+            AutosaveManager::instance()->updateSettingsChanges();
             repaint();
         }
 
@@ -1729,6 +1735,7 @@ namespace Caneda
     {
         if(saveAll()) {
             saveSettings();
+            AutosaveManager::instance()->clear();
             e->accept();
         }
         else {
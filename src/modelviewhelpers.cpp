@@ -67,6 +67,70 @@ namespace Caneda
         return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
     }
 
+    /*************************************************************************
+     *                         SearchResultsModel                            *
+     *************************************************************************/
+    //! \brief Constructor.
+    SearchResultsModel::SearchResultsModel(QObject *parent) :
+        QAbstractListModel(parent)
+    {
+    }
+
+    //! \brief Returns the number of results.
+    int SearchResultsModel::rowCount(const QModelIndex &parent) const
+    {
+        return parent.isValid() ? 0 : m_results.size();
+    }
+
+    //! \brief Returns the data of the source item of a result.
+    QVariant SearchResultsModel::data(const QModelIndex &index, int role) const
+    {
+        QModelIndex source = sourceIndex(index);
+        if(!source.isValid()) {
+            return QVariant();
+        }
+
+        return source.data(role);
+    }
+
+    //! \brief Returns the flags of the source item of a result.
+    Qt::ItemFlags SearchResultsModel::flags(const QModelIndex &index) const
+    {
+        QModelIndex source = sourceIndex(index);
+        if(!source.isValid()) {
+            return Qt::NoItemFlags;
+        }
+
+        return source.flags() & ~Qt::ItemIsEditable;
+    }
+
+    /*!
+     * \brief Sets the results to show, best ranked first.
+     *
+     * \param results Source model indexes, as returned by the model search.
+     */
+    void SearchResultsModel::setResults(const QList<QPersistentModelIndex> &results)
+    {
+        beginResetModel();
+        m_results = results;
+        endResetModel();
+    }
+
+    /*!
+     * \brief Returns the source model index of a result.
+     *
+     * The returned index is invalid if the source item was removed after
+     * the results were set.
+     */
+    QModelIndex SearchResultsModel::sourceIndex(const QModelIndex &index) const
+    {
+        if(!index.isValid() || index.row() >= m_results.size()) {
+            return QModelIndex();
+        }
+
+        return m_results.at(index.row());
+    }
+
     /*************************************************************************
      *                         FileFilterProxyModel                          *
      *************************************************************************/
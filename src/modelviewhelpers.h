@@ -20,7 +20,10 @@
 #ifndef MODEL_VIEW_HELPERS_H
 #define MODEL_VIEW_HELPERS_H
 
+#include <QAbstractListModel>
 #include <QFileIconProvider>
+#include <QList>
+#include <QPersistentModelIndex>
 #include <QSortFilterProxyModel>
 
 namespace Caneda
@@ -49,6 +52,37 @@ namespace Caneda
         QModelIndex m_sourceRoot;
     };
 
+    /*!
+     * \brief The SearchResultsModel class presents a list of search results
+     * as a flat, ranked list.
+     *
+     * Each row of this model refers to an item of a source model, whose data
+     * is returned unchanged. In this way, the results of a SearchIndex query
+     * are shown by setting them with setResults(), which only costs as much as
+     * the results themselves, instead of filtering and sorting the whole
+     * (tree like) source model on each keystroke.
+     *
+     * \sa SearchIndex, SidebarItemsModel::search()
+     */
+    class SearchResultsModel : public QAbstractListModel
+    {
+        Q_OBJECT
+
+    public:
+        explicit SearchResultsModel(QObject *parent = nullptr);
+
+        int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+        QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+        Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+        void setResults(const QList<QPersistentModelIndex> &results);
+        QModelIndex sourceIndex(const QModelIndex &index) const;
+
+    private:
+        //! Source model index of each result, best ranked first.
+        QList<QPersistentModelIndex> m_results;
+    };
+
     /*!
      * \brief The FileFilterProxyModel class helps in filtering a file model in
      * a tree like structure, using the text of a QLineEdit.
@@ -0,0 +1,137 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <QMutex>
+#include <QVector>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace Caneda
+{
+    /*!
+     * \brief This class allocates objects of type T from contiguous blocks.
+     *
+     * Schematics hold large numbers of small objects of a few types (ports,
+     * wires, components and their properties), which are created in bulk
+     * when loading or pasting.
+     * Allocating each one with a separate call to the global operator new is
+     * slow and scatters them over the heap. Instead, this pool carves the
+     * objects out of blocks of BlockSize slots, and keeps the released slots
+     * in a free list for reuse. Blocks are never returned to the system, but
+     * reused by the objects created afterwards.
+     *
+     * Objects can be created and destroyed individually, in any order, and
+     * may be moved between documents (for example, by the undo stack or the
+     * clipboard), so a single pool is shared by all documents. The pool is
+     * thread safe.
+     *
+     * To use the pool, a class declares CANEDA_POOLED_ALLOCATION() in its
+     * body. Derived classes with a different size fall back to the global
+     * operator new and delete.
+     */
+    template<typename T>
+    class ObjectPool
+    {
+    public:
+        //! \brief Returns the memory for one object of type T.
+        static void* allocate()
+        {
+            QMutexLocker locker(&mutex());
+
+            Slot *&freeList = head();
+            if(!freeList) {
+                grow();
+            }
+
+            Slot *slot = freeList;
+            freeList = slot->next;
+            return slot;
+        }
+
+        //! \brief Releases the memory of an object previously allocated.
+        static void release(void *pointer)
+        {
+            if(!pointer) {
+                return;
+            }
+
+            QMutexLocker locker(&mutex());
+
+            Slot *slot = static_cast<Slot*>(pointer);
+            slot->next = head();
+            head() = slot;
+        }
+
+    private:
+        //! Number of objects in each block.
+        static const int BlockSize = 256;
+
+        //! Storage of one object, linked in the free list while unused.
+        union Slot
+        {
+            Slot *next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        //! Allocates a new block, adding its slots to the free list.
+        static void grow()
+        {
+            Slot *block = static_cast<Slot*>(::operator new(sizeof(Slot) * BlockSize));
+            blocks() << block;
+
+            for(int i = 0; i < BlockSize - 1; ++i) {
+                block[i].next = &block[i + 1];
+            }
+            block[BlockSize - 1].next = head();
+            head() = block;
+        }
+
+        static QMutex& mutex() { static QMutex m; return m; }
+        static Slot*& head() { static Slot *h = nullptr; return h; }
+        static QVector<Slot*>& blocks() { static QVector<Slot*> b; return b; }
+    };
+
+} // namespace Caneda
+
+/*!
+ * \brief Makes a class allocate its objects from a Caneda::ObjectPool.
+ *
+ * \sa Caneda::ObjectPool
+ */
+#define CANEDA_POOLED_ALLOCATION(Class) \
+    static void* operator new(std::size_t size) \
+    { \
+        return size == sizeof(Class) ? Caneda::ObjectPool<Class>::allocate() : ::operator new(size); \
+    } \
+    static void operator delete(void *pointer, std::size_t size) \
+    { \
+        if(size == sizeof(Class)) { \
+            Caneda::ObjectPool<Class>::release(pointer); \
+        } \
+        else { \
+            ::operator delete(pointer); \
+        } \
+    }
+
+#endif //OBJECT_POOL_H
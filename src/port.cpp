@@ -20,12 +20,11 @@
 
 #include "port.h"
 
+#include "graphicsscene.h"
 #include "settings.h"
 #include "wire.h"
 
-#include <QGraphicsItem>
 #include <QPainter>
-#include <QStyleOptionGraphicsItem>
 
 namespace Caneda
 {
@@ -33,12 +32,9 @@ namespace Caneda
      * \brief Constructs a Port item with a GraphicsItem as \a parent and
      * port's name \a portName.
      */
-    Port::Port(GraphicsItem *parent) : QGraphicsItem(parent)
+    Port::Port(GraphicsItem *parent) :
+        m_parentItem(parent)
     {
-        // Set component flags
-        setFlag(ItemSendsGeometryChanges, true);
-        setFlag(ItemSendsScenePositionChanges, true);
-
         m_connections.append(this);
     }
 
@@ -46,19 +42,28 @@ namespace Caneda
     Port::~Port()
     {
         disconnect();
+
+        // The scene is not notified of the removal of deleted items
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->removePort(this);
+        }
     }
 
     /*!
-     *  \brief Returns a pointer to this item's parent item. If this item does
-     *  not have a parent, 0 is returned.
+     * \brief Sets the port's position, in parent's coordinates.
+     *
+     * The parent item must call prepareGeometryChange() beforehand if its
+     * bounding rect depends on its ports positions.
      */
-    GraphicsItem* Port::parentItem() const
+    void Port::setPos(const QPointF &pos)
     {
-        GraphicsItem *item = canedaitem_cast<GraphicsItem*>(QGraphicsItem::parentItem());
-        if(item) {
-            return item;
+        m_pos = pos;
+
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->insertPort(this);
         }
-        return nullptr;
     }
 
     /*!
@@ -137,7 +142,7 @@ namespace Caneda
 
         // Update all ports parents.
         foreach(Port *p, m_connections) {
-            p->parentItem()->update();
+            p->update();
         }
     }
 
@@ -159,14 +164,14 @@ namespace Caneda
         // Disconnect this port from every connected port
         foreach(Port *p, m_connections) {
             p->m_connections.removeAll(this);
-            p->parentItem()->update();
+            p->update();
         }
 
         m_connections.clear();
         m_connections.append(this);
 
         // Update parent item.
-        parentItem()->update();
+        update();
     }
 
     //! \brief Check if port \a other is connected to this port.
@@ -184,28 +189,26 @@ namespace Caneda
         return retVal;
     }
 
-    //! \brief Finds a coinciding port on schematic.
+    /*!
+     * \brief Finds a coinciding port on schematic.
+     *
+     * The port is looked up in the scene's hash of port positions, instead
+     * of testing the ports of every item colliding with the parent item.
+     *
+     * \sa GraphicsScene::portsAt()
+     */
     Port* Port::findCoincidingPort() const
     {
-        if(!scene()) {
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(!graphicsScene) {
             return nullptr;
         }
 
-        QList<QGraphicsItem*> collisions =
-            parentItem()->collidingItems(Qt::IntersectsItemBoundingRect);
-
-        foreach(QGraphicsItem *item, collisions) {
-            if(canedaitem_cast<GraphicsItem*>(item)) {
-
-                QList<Port*> ports = canedaitem_cast<GraphicsItem*>(item)->ports();
-                foreach(Port *p, ports) {
-                    if(p->scenePos() == scenePos() &&
-                            p->parentItem() != parentItem() &&
-                            !m_connections.contains(p)) {
-                        return p;
-                    }
-                }
-
+        foreach(Port *p, graphicsScene->portsAt(scenePos())) {
+            if(p->scenePos() == scenePos() &&
+                    p->parentItem() != parentItem() &&
+                    !m_connections.contains(p)) {
+                return p;
             }
         }
 
@@ -218,11 +221,14 @@ namespace Caneda
      *  Ports are drawn only if:
      *    \li the port is not connected
      *    \li there are more than two connections to the port
+     *
+     * \param painter Painter to draw with, as set up by the caller.
+     * \param center Center of the port marker, in \a painter coordinates.
+     *
+     * \sa GraphicsItem::paintPorts()
      */
-    void Port::paint(QPainter *painter, const QStyleOptionGraphicsItem* option, QWidget*)
+    void Port::paint(QPainter *painter, const QPointF &center) const
     {
-        Q_UNUSED(option)
-
         // Save pen
         QPen savedPen = painter->pen();
 
@@ -231,24 +237,43 @@ namespace Caneda
         if(m_connections.size() <= 1) {
             painter->setPen(QPen(Qt::darkRed));
             painter->setBrush(Qt::NoBrush);
-            painter->drawEllipse(portEllipse);
+            painter->drawEllipse(portEllipse.translated(center));
         }
-        else if(m_connections.size() > 2 && parentItem()->isSelected()) {
+        else if(m_connections.size() > 2 && m_parentItem->isSelected()) {
             painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
                                  settings->currentValue("gui/lineWidth").toInt()));
             painter->setBrush(QBrush(settings->currentValue("gui/selectionColor").value<QColor>()));
-            painter->drawEllipse(portEllipse.adjusted(1,1,-1,-1));  // Adjust the ellipse to be just a little smaller than the open port
+            painter->drawEllipse(portEllipse.adjusted(1,1,-1,-1).translated(center));  // Adjust the ellipse to be just a little smaller than the open port
         }
         else if(m_connections.size() > 2) {
             painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
                                  settings->currentValue("gui/lineWidth").toInt()));
             painter->setBrush(QBrush(settings->currentValue("gui/lineColor").value<QColor>()));
-            painter->drawEllipse(portEllipse.adjusted(1,1,-1,-1));  // Adjust the ellipse to be just a little smaller than the open port
+            painter->drawEllipse(portEllipse.adjusted(1,1,-1,-1).translated(center));  // Adjust the ellipse to be just a little smaller than the open port
         }
 
         // Restore pen
         painter->setPen(savedPen);
+    }
+
+    /*!
+     * \brief Schedules a redraw of the port, after a connection change.
+     *
+     * Unselected wires are drawn by the scene's wire layer instead of by
+     * the wire items, so the wire layer must be updated too.
+     *
+     * \sa GraphicsScene::updateWire()
+     */
+    void Port::update()
+    {
+        m_parentItem->update();
 
+        if(m_parentItem->type() == GraphicsItem::WireType) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                graphicsScene->updateWire(static_cast<Wire*>(m_parentItem));
+            }
+        }
     }
 
 } // namespace Caneda
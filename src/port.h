@@ -22,6 +22,7 @@
 #define PORT_H
 
 #include "graphicsitem.h"
+#include "objectpool.h"
 
 #include <QList>
 #include <QSharedData>
@@ -37,15 +38,15 @@ namespace Caneda
     //! \brief Sharable port's data.
     struct PortData : public QSharedData
     {
-        explicit PortData(QPointF _pos, QString _name) : pos(_pos), name(_name) {}
+        explicit PortData(QPointF _pos, QString _name) : pos(_pos), name(Caneda::internString(_name)) {}
 
         QPointF pos;
         QString name;
     };
 
     /*!
-     * \brief The Port class is an electric port graphical representation, that
-     * allows components to be connected together through the use of wires.
+     * \brief The Port class is an electric port representation, that allows
+     * components to be connected together through the use of wires.
      *
      * This class always has a parent item (GraphicsItem) and cannot be moved
      * on its own. The port position on a scene is determined from the parent's
@@ -53,6 +54,15 @@ namespace Caneda
      * can be connected to multiple ports, thus allowing interconnection of
      * electric components such as wires, pasive and active components, etc.
      *
+     * Ports are not graphics items themselves, but plain records owned by
+     * their parent item. Their position is kept in the parent's coordinate
+     * system, and their scene position is computed on demand from the
+     * parent's transform. In this way, moving an item does not send a
+     * notification to each one of its ports, and the scene does not have to
+     * index and paint one item per port. Ports are drawn by their parent item
+     * (see GraphicsItem::paintPorts()), or by the scene's WireLayer for
+     * unselected wires.
+     *
      * A disconnected port (that only has its parent) is represented by a
      * hollow circle, while a connected port (with only one connection) is not
      * drawn. When multiple connections are made into one port, a filled circle
@@ -60,17 +70,29 @@ namespace Caneda
      *
      * \sa Component, Wire
      */
-    class Port : public QGraphicsItem
+    class Port
     {
     public:
-        explicit Port(GraphicsItem *parent = nullptr);
-        ~Port() override;
+        explicit Port(GraphicsItem *parent);
+        ~Port();
+
+        CANEDA_POOLED_ALLOCATION(Port)
 
         //! Returns the port's name.
         QString name() const { return m_name; }
-        void setName(const QString &newName) { m_name = newName; }
+        //! Sets the port's name (interned, see Caneda::internString()).
+        void setName(const QString &newName) { m_name = Caneda::internString(newName); }
 
-        GraphicsItem* parentItem() const;
+        //! Returns the item owning this port.
+        GraphicsItem* parentItem() const { return m_parentItem; }
+        //! Returns the scene of the parent item.
+        QGraphicsScene* scene() const { return m_parentItem->scene(); }
+
+        //! Returns the port's position, in parent's coordinates.
+        QPointF pos() const { return m_pos; }
+        void setPos(const QPointF &pos);
+        //! Returns the port's position, in scene coordinates.
+        QPointF scenePos() const { return m_parentItem->mapToScene(m_pos); }
 
         //! Returns a pointer to list of connected ports
         QList<Port*> *connections() { return &(m_connections); }
@@ -84,11 +106,13 @@ namespace Caneda
 
         Port* findCoincidingPort() const;
 
-        //! Return bounding box
-        QRectF boundingRect() const override { return portEllipse; }
-        void paint(QPainter *painter, const QStyleOptionGraphicsItem* option, QWidget*) override;
+        void paint(QPainter *painter, const QPointF &center) const;
 
     private:
+        void update();
+
+        GraphicsItem *m_parentItem;
+        QPointF m_pos;
         QString m_name;
         QList<Port*> m_connections;
     };
@@ -148,6 +148,8 @@ namespace Caneda
 
         // Restore pen
         painter->setPen(savedPen);
+
+        paintPorts(painter, option);
     }
 
     //! \copydoc GraphicsItem::copy()
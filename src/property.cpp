@@ -20,7 +20,9 @@
 
 #include "property.h"
 
+#include "component.h"
 #include "global.h"
+#include "graphicsscene.h"
 #include "propertydialog.h"
 #include "settings.h"
 #include "xmlutilities.h"
@@ -71,7 +73,7 @@ namespace Caneda
                        bool visible)
     {
         d = new PropertyData;
-        d->name = name;
+        d->name = Caneda::internString(name);
         d->value = value;
         d->description = description;
         d->visible = visible;
@@ -82,6 +84,19 @@ namespace Caneda
     {
     }
 
+    //! \brief Returns true if both properties hold the same data.
+    bool Property::operator==(const Property &other) const
+    {
+        if(d.constData() == other.d.constData()) {
+            return true;
+        }
+
+        return d->name == other.d->name &&
+                d->value == other.d->value &&
+                d->description == other.d->description &&
+                d->visible == other.d->visible;
+    }
+
     /*!
      * \brief Method used to create a property from an xml file.
      *
@@ -94,7 +109,7 @@ namespace Caneda
 
         QXmlStreamAttributes attributes = reader->attributes();
 
-        data->name = attributes.value("name").toString();
+        data->name = Caneda::internString(attributes.value("name").toString());
         if(data->name.isEmpty()) {
             reader->raiseError("Couldn't find name attribute in property description");
             return Property();
@@ -162,32 +177,90 @@ namespace Caneda
      * \param parent Parent of the item.
      */
     PropertyGroup::PropertyGroup(QGraphicsItem *parent) :
-        QGraphicsSimpleTextItem(parent)
+        QGraphicsSimpleTextItem(parent),
+        m_sharedDefaults(false),
+        m_displayDirty(false)
     {
         m_userPropertiesEnabled = false;
 
+        m_staticText.setTextFormat(Qt::PlainText);
+
         // Set items flags
         setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
         setFlag(ItemSendsGeometryChanges, true);
         setFlag(ItemSendsScenePositionChanges, true);
     }
 
+    //! \brief Destructor.
+    PropertyGroup::~PropertyGroup()
+    {
+        // The scene is not notified of the removal of deleted items
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->cancelPropertyDisplay(this);
+        }
+    }
+
     //! \brief Adds a new property to the PropertyMap.
     void PropertyGroup::addProperty(const QString& key, const Property &prop)
     {
-        m_propertyMap.insert(key, prop);
+        storeProperty(key, prop);
         updatePropertyDisplay();  // This is necessary to update the properties display on a scene
     }
 
+    //! \brief Returns true if the group holds a property named \a key.
+    bool PropertyGroup::contains(const QString &key) const
+    {
+        return overrideIndex(key) >= 0 || m_defaults.contains(key);
+    }
+
+    /*!
+     * \brief Returns the property \a key, or an empty property if not found.
+     *
+     * Properties not overridden by this group are read from the shared
+     * defaults table.
+     */
+    Property PropertyGroup::property(const QString &key) const
+    {
+        const int index = overrideIndex(key);
+        if(index >= 0) {
+            return m_overrides.at(index);
+        }
+
+        return m_defaults.value(key);
+    }
+
     //! \brief Sets property \a key to \a value in the PropertyMap.
     void PropertyGroup::setPropertyValue(const QString& key, const QString& value)
     {
-        if(m_propertyMap.contains(key)) {
-            m_propertyMap[key].setValue(value);
+        if(contains(key)) {
+            Property prop = property(key);
+            prop.setValue(value);
+            storeProperty(key, prop);
             updatePropertyDisplay();  // This is necessary to update the properties display on a scene
         }
     }
 
+    /*!
+     * \brief Returns the property map.
+     *
+     * If no property is overridden, the shared defaults table itself is
+     * returned. Otherwise, a copy of the defaults with the overrides applied
+     * is built.
+     */
+    PropertyMap PropertyGroup::propertyMap() const
+    {
+        if(m_overrides.isEmpty()) {
+            return m_defaults;
+        }
+
+        PropertyMap propMap = m_defaults;
+        foreach(const Property &prop, m_overrides) {
+            propMap.insert(prop.name(), prop);
+        }
+        return propMap;
+    }
+
     /*!
      * \brief Set all the properties values through a PropertyMap.
      *
@@ -201,7 +274,44 @@ namespace Caneda
      */
     void PropertyGroup::setPropertyMap(const PropertyMap& propMap)
     {
-        m_propertyMap = propMap;
+        m_overrides.clear();
+
+        // Keep the shared defaults only if no default property was removed
+        bool keepDefaults = m_sharedDefaults;
+        for(PropertyMap::const_iterator it = m_defaults.constBegin();
+                keepDefaults && it != m_defaults.constEnd(); ++it) {
+            keepDefaults = propMap.contains(it.key());
+        }
+
+        if(keepDefaults) {
+            for(PropertyMap::const_iterator it = propMap.constBegin(); it != propMap.constEnd(); ++it) {
+                storeProperty(it.key(), it.value());
+            }
+        }
+        else {
+            m_defaults = propMap;
+            m_sharedDefaults = false;
+        }
+
+        updatePropertyDisplay();  // This is necessary to update the properties display on a scene
+    }
+
+    /*!
+     * \brief Shares the properties of another group.
+     *
+     * The defaults table of \a other (for example, the properties of a
+     * library component) is shared, not copied, and the overrides of
+     * \a other are copied. Further changes to this group are stored as
+     * overrides on top of the shared table, leaving \a other untouched.
+     *
+     * \sa ComponentData::setData()
+     */
+    void PropertyGroup::shareProperties(const PropertyGroup *other)
+    {
+        m_defaults = other->m_defaults;
+        m_overrides = other->m_overrides;
+        m_sharedDefaults = true;
+
         updatePropertyDisplay();  // This is necessary to update the properties display on a scene
     }
 
@@ -226,56 +336,86 @@ namespace Caneda
      * This method is key to alter the visual display text of given properties. It
      * should be called wherever a property changes.
      *
-     * To update the visual display, it recreates all individual properties display
-     * from the group and then adds them to the plaintext property of this item (if
-     * the given property is visible). This method also updates the visible value of
-     * the property.
+     * The label of the parent component is updated right away in the scene
+     * labels registry, while the display text itself is only marked as
+     * outdated. The text is laid out again by layoutPropertyDisplay(), once
+     * per event loop turn for items in a GraphicsScene, or when the item is
+     * added to a scene.
+     *
+     * \sa layoutPropertyDisplay(), GraphicsScene::schedulePropertyDisplay()
      */
     void PropertyGroup::updatePropertyDisplay()
     {
-        bool itemsVisible = false;
-
-        // Determine if any item is visible.
-        foreach(const Property property, m_propertyMap) {
-            if(property.isVisible()) {
-                 itemsVisible = true;
-                 break;
-            }
+        // Keep the scene labels registry in sync with the component label
+        Component *component = canedaitem_cast<Component*>(parentItem());
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(component && graphicsScene) {
+            graphicsScene->insertComponentLabel(component);
         }
 
-        // Hide the display if none of the properties are visible.
-        if(!itemsVisible) {
-            hide();
-            return;
+        m_displayDirty = true;
+
+        if(graphicsScene) {
+            graphicsScene->schedulePropertyDisplay(this);
+        }
+        else if(scene()) {
+            layoutPropertyDisplay();
         }
+    }
+
+    /*!
+     * \brief Lays out the display text of the visible properties.
+     *
+     * This method recreates all individual properties display from the group
+     * and then adds them to the plaintext property of this item (if the given
+     * property is visible), caching the result in a QStaticText. If none of
+     * the properties is visible, the item is hidden.
+     *
+     * \sa updatePropertyDisplay()
+     */
+    void PropertyGroup::layoutPropertyDisplay()
+    {
+        m_displayDirty = false;
 
-        // Else update its value, and make visible (show()).
         QString newValue;  // New value to set
+        bool itemsVisible = false;
 
         // Iterate through all properties to add its values
-        foreach(const Property property, m_propertyMap) {
-            if(property.isVisible()) {
+        const PropertyMap propMap = propertyMap();
+        foreach(const Property &property, propMap) {
+            if(!property.isVisible()) {
+                continue;
+            }
 
-                QString propertyText = QString();  // Current property text
+            // Add the property to the group
+            if(itemsVisible) {
+                newValue.append("\n");  // If already has properties, add newline
+            }
+            itemsVisible = true;
 
-                // Add property name (except for the label property)
-                if(!property.name().startsWith("label", Qt::CaseInsensitive)) {
-                    propertyText = property.name() + " = ";
-                }
+            // Add property name (except for the label property)
+            if(!property.name().startsWith("label", Qt::CaseInsensitive)) {
+                newValue.append(property.name()).append(" = ");
+            }
 
-                // Add property value
-                propertyText.append(property.value());
+            // Add property value
+            newValue.append(property.value());
+        }
 
-                // Add the property to the group
-                if(!newValue.isEmpty()) {
-                    newValue.append("\n");  // If already has properties, add newline
-                }
-                newValue.append(propertyText);
-            }
+        // Hide the display if none of the properties are visible.
+        if(!itemsVisible) {
+            hide();
+            return;
         }
 
-        // Set new properties values
-        setText(newValue);
+        // Set new properties values, if changed
+        if(newValue != text()) {
+            setText(newValue);
+
+            QString staticText = newValue;
+            staticText.replace('\n', QChar::LineSeparator);
+            m_staticText.setText(staticText);
+        }
 
         // Make item visible
         show();
@@ -298,9 +438,13 @@ namespace Caneda
     void PropertyGroup::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
             QWidget *widget)
     {
-        Q_UNUSED(option)
         Q_UNUSED(widget)
 
+        // Property texts are not legible when zoomed out, so skip them
+        if(option->levelOfDetailFromTransform(painter->worldTransform()) < Caneda::LodDetailsThreshold) {
+            return;
+        }
+
         // Save pen
         QPen savedPen = painter->pen();
 
@@ -316,19 +460,32 @@ namespace Caneda
         }
 
         // Paint the property text
-        painter->drawText(boundingRect(), text());
+        painter->drawStaticText(boundingRect().topLeft(), m_staticText);
 
         // Restore pen
         painter->setPen(savedPen);
     }
 
-    //! \brief Helper method to write all properties in \a m_propertyMap to xml.
+    //! \brief Helper method to write all properties in the property group to xml.
     void PropertyGroup::writeProperties(Caneda::XmlWriter *writer)
+    {
+        writeProperties(writer, pos(), propertyMap());
+    }
+
+    /*!
+     * \brief Helper method to write a properties map to xml.
+     *
+     * This method only reads its arguments, and thus it may be used from a
+     * worker thread on a copy of the properties (for example, while
+     * autosaving).
+     */
+    void PropertyGroup::writeProperties(Caneda::XmlWriter *writer, const QPointF &pos,
+                                        const PropertyMap &propertyMap)
     {
         writer->writeStartElement("properties");
-        writer->writePointAttribute(pos(), "pos");
+        writer->writePointAttribute(pos, "pos");
 
-        foreach(const Property p, m_propertyMap) {
+        foreach(const Property p, propertyMap) {
             writer->writeEmptyElement("property");
             writer->writeAttribute("name", p.name());
             writer->writeAttribute("value", p.value());
@@ -338,7 +495,7 @@ namespace Caneda
         writer->writeEndElement(); // </properties>
     }
 
-    //! \brief Helper method to read xml saved properties into \a m_propertyMap.
+    //! \brief Helper method to read xml saved properties into the property group.
     void PropertyGroup::readProperties(Caneda::XmlReader *reader)
     {
         Q_ASSERT(reader->isStartElement() && reader->name() == "properties");
@@ -355,14 +512,15 @@ namespace Caneda
                 if(reader->name() == "property") {
                     QXmlStreamAttributes attribs(reader->attributes());
                     QString propName = attribs.value("name").toString();
-                    if(!m_propertyMap.contains(propName)) {
+                    if(!contains(propName)) {
                         qWarning() << "readProperties() : " << "Property " << propName
                                    << "not found in map!";
                     }
                     else {
-                        Property &prop = m_propertyMap[propName];
+                        Property prop = property(propName);
                         prop.setValue(attribs.value("value").toString());
                         prop.setVisible(attribs.value("visible") == "true");
+                        storeProperty(propName, prop);
                     }
                     // Read till end element
                     reader->readUnknownElement();
@@ -383,6 +541,73 @@ namespace Caneda
         dialog.exec();
     }
 
+    /*!
+     * \brief Keeps the deferred display update on the item's current scene.
+     *
+     * A pending update is dropped when the item leaves a GraphicsScene, and an
+     * outdated display is laid out as soon as the item is added to a scene.
+     *
+     * \sa updatePropertyDisplay()
+     */
+    QVariant PropertyGroup::itemChange(GraphicsItemChange change, const QVariant &value)
+    {
+        if(change == ItemSceneChange) {
+            GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+            if(graphicsScene) {
+                graphicsScene->cancelPropertyDisplay(this);
+            }
+        }
+        else if(change == ItemSceneHasChanged && m_displayDirty && scene()) {
+            layoutPropertyDisplay();
+        }
+
+        return QGraphicsSimpleTextItem::itemChange(change, value);
+    }
+
+    /*!
+     * \brief Stores a property in the group.
+     *
+     * In groups sharing a defaults table, only the properties differing from
+     * (or missing in) the defaults are kept, as a small list of overrides.
+     * Otherwise, the property is stored in the group's own table.
+     *
+     * \sa shareProperties()
+     */
+    void PropertyGroup::storeProperty(const QString &key, const Property &prop)
+    {
+        if(!m_sharedDefaults) {
+            m_defaults.insert(key, prop);
+            return;
+        }
+
+        const int index = overrideIndex(key);
+        PropertyMap::const_iterator it = m_defaults.constFind(key);
+
+        if(it != m_defaults.constEnd() && it.value() == prop) {
+            if(index >= 0) {
+                m_overrides.remove(index);
+            }
+        }
+        else if(index >= 0) {
+            m_overrides[index] = prop;
+        }
+        else {
+            m_overrides << prop;
+        }
+    }
+
+    //! \brief Returns the index of the override of property \a key, or -1.
+    int PropertyGroup::overrideIndex(const QString &key) const
+    {
+        for(int i = 0; i < m_overrides.size(); ++i) {
+            if(m_overrides.at(i).name() == key) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
     //! \brief On mouse click deselect selected items other than this.
     void PropertyGroup::mousePressEvent(QGraphicsSceneMouseEvent *event)
     {
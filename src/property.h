@@ -21,7 +21,12 @@
 #ifndef PROPERTY_H
 #define PROPERTY_H
 
+#include "global.h"
+#include "objectpool.h"
+
 #include <QGraphicsSimpleTextItem>
+#include <QStaticText>
+#include <QVector>
 
 namespace Caneda
 {
@@ -41,6 +46,8 @@ namespace Caneda
         explicit PropertyData();
         explicit PropertyData(const PropertyData& p);
 
+        CANEDA_POOLED_ALLOCATION(PropertyData)
+
         QString name;
         QString value;
         QString description;
@@ -73,10 +80,14 @@ namespace Caneda
                           bool visible=false);
         explicit Property(QSharedDataPointer<PropertyData> data);
 
+        bool operator==(const Property &other) const;
+        //! Returns true if the properties hold different data.
+        bool operator!=(const Property &other) const { return !(*this == other); }
+
         //! Returns the property name.
         QString name() const { return d->name; }
         //! Sets the value of property to \a newValue.
-        void setName(const QString &newName) { d->name = newName; }
+        void setName(const QString &newName) { d->name = Caneda::internString(newName); }
 
         //! Returns the value of property.
         QString value() const { return d->value; }
@@ -109,51 +120,92 @@ namespace Caneda
      * \brief Class used to group properties all together and render
      * them on a scene.
      *
-     * Gouping several properties into a QMap (m_propertyMap) provides
+     * Gouping several properties into a QMap (PropertyMap) provides
      * a convenient way of handling them all together. In this way, for
      * example, the properties of a component can be selected and moved
      * all at once.
      *
+     * A placed component usually changes only a few of its properties from
+     * the library defaults. Thus, a group may share the (implicitly shared)
+     * defaults table of another group (see shareProperties()), and store
+     * only the properties differing from it as a short list of overrides.
+     * Reads fall through to the defaults table, and propertyMap() returns
+     * the merged properties, so this is transparent to the callers.
+     *
      * While Property class holds actual properties, PropertyGroup class
      * groups them all together and renders them on a scene, allowing
      * selection and moving of all properties at once.
      *
-     * \sa PropertyData, Property
+     * Changes to the properties do not rebuild the displayed text right
+     * away. Instead, the rebuild is deferred and coalesced by the
+     * GraphicsScene into one update per event loop turn, so that setting
+     * many properties in a row (for example, while loading a component)
+     * lays out the text only once. The laid out text is cached in a
+     * QStaticText, to avoid shaping the text on every repaint.
+     *
+     * \sa PropertyData, Property, GraphicsScene::schedulePropertyDisplay()
      */
     class PropertyGroup : public QGraphicsSimpleTextItem
     {
     public:
         explicit PropertyGroup(QGraphicsItem *parent = nullptr);
+        ~PropertyGroup() override;
+
+        CANEDA_POOLED_ALLOCATION(PropertyGroup)
 
         void addProperty(const QString& key, const Property& prop);
+        bool contains(const QString &key) const;
+        Property property(const QString &key) const;
         //! Returns selected property from property map.
-        QString propertyValue(const QString& key) const { return m_propertyMap[key].value(); }
+        QString propertyValue(const QString& key) const { return property(key).value(); }
         void setPropertyValue(const QString& key, const QString& value);
 
-        //! Returns the property map (actually a copy of property map).
-        PropertyMap propertyMap() const { return m_propertyMap; }
+        PropertyMap propertyMap() const;
         void setPropertyMap(const PropertyMap& propMap);
+        void shareProperties(const PropertyGroup *other);
 
         //! Returns if the user is enabled to add or remove properties.
         bool userPropertiesEnabled() const { return m_userPropertiesEnabled; }
         void setUserPropertiesEnabled(const bool enable);
 
         void updatePropertyDisplay();
+        void layoutPropertyDisplay();
         void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                    QWidget *widget = nullptr) override;
 
         void writeProperties(Caneda::XmlWriter *writer);
+        static void writeProperties(Caneda::XmlWriter *writer, const QPointF &pos,
+                                    const PropertyMap &propertyMap);
         void readProperties(Caneda::XmlReader *reader);
 
         void launchPropertiesDialog();
 
     protected:
+        QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+
         void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
         void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
 
     private:
-        //! QMap holding actual properties.
-        PropertyMap m_propertyMap;
+        void storeProperty(const QString &key, const Property &prop);
+        int overrideIndex(const QString &key) const;
+
+        /*!
+         * \brief Defaults table of the properties.
+         *
+         * This table is shared with the group the properties were taken from
+         * (if m_sharedDefaults is true), and is never modified in that case.
+         */
+        PropertyMap m_defaults;
+        //! Properties differing from (or missing in) the shared defaults.
+        QVector<Property> m_overrides;
+        //! True if m_defaults is shared, and changes are stored as overrides.
+        bool m_sharedDefaults;
+
+        //! Laid out properties text, as drawn by paint().
+        QStaticText m_staticText;
+        //! True if the properties changed since the text was last laid out.
+        bool m_displayDirty;
 
         /*!
          * \brief Holds the user created properties enable status.
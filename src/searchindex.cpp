@@ -0,0 +1,364 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "searchindex.h"
+
+#include <algorithm>
+
+namespace Caneda
+{
+    //! \brief Weight of the words found in a document name.
+    static const int NameWeight = 3;
+    //! \brief Weight of the words found in a document free text.
+    static const int TextWeight = 1;
+
+    //! \brief Minimum trigram similarity for a fuzzy match.
+    static const qreal FuzzyThreshold = 0.4;
+
+    //! \brief Constructor.
+    SearchIndex::SearchIndex() :
+        m_sortedWordsDirty(false)
+    {
+    }
+
+    /*!
+     * \brief Adds a document to the index.
+     *
+     * \param name Name of the document (for example a component name).
+     * \param text Free text of the document.
+     * \return Id of the new document, as returned by search().
+     */
+    int SearchIndex::insert(const QString &name, const QString &text)
+    {
+        int id;
+        if(!m_freeIds.isEmpty()) {
+            id = m_freeIds.takeLast();
+            m_names[id] = name.toLower();
+        }
+        else {
+            id = m_names.size();
+            m_names << name.toLower();
+            m_documentWords << QVector<int>();
+        }
+
+        addWords(id, name, NameWeight);
+        addWords(id, text, TextWeight);
+
+        return id;
+    }
+
+    /*!
+     * \brief Removes the document \a id from the index.
+     *
+     * The postings of the document are purged, and its id may be returned
+     * again by a later insert().
+     */
+    void SearchIndex::remove(int id)
+    {
+        if(id < 0 || id >= m_names.size() || m_freeIds.contains(id)) {
+            return;
+        }
+
+        foreach(int wordId, m_documentWords.at(id)) {
+            QVector<Posting> &postings = m_words[wordId].postings;
+            for(int i = 0; i < postings.size(); ++i) {
+                if(postings.at(i).id == id) {
+                    postings.remove(i);
+                    break;
+                }
+            }
+
+            if(postings.isEmpty()) {
+                removeWord(wordId);
+            }
+        }
+
+        m_documentWords[id].clear();
+        m_names[id].clear();
+        m_freeIds << id;
+    }
+
+    //! \brief Removes all documents from the index.
+    void SearchIndex::clear()
+    {
+        m_words.clear();
+        m_wordIds.clear();
+        m_sortedWords.clear();
+        m_sortedWordsDirty = false;
+        m_trigrams.clear();
+        m_freeWords.clear();
+        m_names.clear();
+        m_documentWords.clear();
+        m_freeIds.clear();
+    }
+
+    /*!
+     * \brief Searches the index.
+     *
+     * \param query Text to search, in one or more words.
+     * \return Ids of the matching documents, best ranked first.
+     */
+    QList<int> SearchIndex::search(const QString &query) const
+    {
+        QStringList tokens = tokenize(query);
+        if(tokens.isEmpty()) {
+            return QList<int>();
+        }
+
+        // Score every document for each token, keeping only the documents
+        // matching all tokens
+        QHash<int, qreal> documentScores;
+        for(int i = 0; i < tokens.size(); ++i) {
+            QHash<int, qreal> wordScores;
+            prefixMatches(tokens.at(i), &wordScores);
+            fuzzyMatches(tokens.at(i), &wordScores);
+
+            QHash<int, qreal> tokenScores;
+            for(QHash<int, qreal>::const_iterator it = wordScores.constBegin();
+                    it != wordScores.constEnd(); ++it) {
+                foreach(const Posting &posting, m_words.at(it.key()).postings) {
+                    qreal score = it.value() * posting.weight;
+                    if(score > tokenScores.value(posting.id)) {
+                        tokenScores[posting.id] = score;
+                    }
+                }
+            }
+
+            if(i == 0) {
+                documentScores = tokenScores;
+                continue;
+            }
+
+            QHash<int, qreal>::iterator it = documentScores.begin();
+            while(it != documentScores.end()) {
+                if(tokenScores.contains(it.key())) {
+                    it.value() += tokenScores.value(it.key());
+                    ++it;
+                }
+                else {
+                    it = documentScores.erase(it);
+                }
+            }
+        }
+
+        // Rank the results
+        QVector<QPair<qreal, int> > ranking;
+        ranking.reserve(documentScores.size());
+        for(QHash<int, qreal>::const_iterator it = documentScores.constBegin();
+                it != documentScores.constEnd(); ++it) {
+            ranking << qMakePair(it.value(), it.key());
+        }
+
+        std::sort(ranking.begin(), ranking.end(),
+                  [this](const QPair<qreal, int> &lhs, const QPair<qreal, int> &rhs) {
+            if(lhs.first != rhs.first) {
+                return lhs.first > rhs.first;
+            }
+            return m_names.at(lhs.second) < m_names.at(rhs.second);
+        });
+
+        QList<int> results;
+        results.reserve(ranking.size());
+        for(int i = 0; i < ranking.size(); ++i) {
+            results << ranking.at(i).second;
+        }
+
+        return results;
+    }
+
+    //! \brief Indexes the words of \a text as part of document \a id.
+    void SearchIndex::addWords(int id, const QString &text, int weight)
+    {
+        foreach(const QString &token, tokenize(text)) {
+            int wordId = m_wordIds.value(token, -1);
+
+            if(wordId < 0) {
+                if(!m_freeWords.isEmpty()) {
+                    wordId = m_freeWords.takeLast();
+                    m_words[wordId].text = token;
+                }
+                else {
+                    wordId = m_words.size();
+                    Word word;
+                    word.text = token;
+                    m_words << word;
+                }
+                m_wordIds.insert(token, wordId);
+                m_sortedWordsDirty = true;
+
+                foreach(quint64 trigram, trigrams(token)) {
+                    QVector<int> &words = m_trigrams[trigram];
+                    if(words.isEmpty() || words.last() != wordId) {
+                        words << wordId;
+                    }
+                }
+            }
+
+            // Keep only the best weight of a word per document
+            QVector<Posting> &postings = m_words[wordId].postings;
+            if(!postings.isEmpty() && postings.last().id == id) {
+                postings.last().weight = qMax(postings.last().weight, weight);
+            }
+            else {
+                Posting posting;
+                posting.id = id;
+                posting.weight = weight;
+                postings << posting;
+                m_documentWords[id] << wordId;
+            }
+        }
+    }
+
+    //! \brief Drops the word \a wordId, once it has no postings left.
+    void SearchIndex::removeWord(int wordId)
+    {
+        Word &word = m_words[wordId];
+
+        foreach(quint64 trigram, trigrams(word.text)) {
+            QHash<quint64, QVector<int> >::iterator it = m_trigrams.find(trigram);
+            if(it != m_trigrams.end()) {
+                it.value().removeOne(wordId);
+                if(it.value().isEmpty()) {
+                    m_trigrams.erase(it);
+                }
+            }
+        }
+
+        m_wordIds.remove(word.text);
+        word.text.clear();
+        m_freeWords << wordId;
+        m_sortedWordsDirty = true;
+    }
+
+    /*!
+     * \brief Scores the words equal to or starting with \a token.
+     *
+     * Exact matches score 1.0, and prefix matches score between 0.6 and 0.9
+     * depending on how much of the word is covered by the token.
+     */
+    void SearchIndex::prefixMatches(const QString &token, QHash<int, qreal> *scores) const
+    {
+        if(m_sortedWordsDirty) {
+            m_sortedWords.clear();
+            for(int i = 0; i < m_words.size(); ++i) {
+                if(!m_words.at(i).postings.isEmpty()) {
+                    m_sortedWords << i;
+                }
+            }
+            std::sort(m_sortedWords.begin(), m_sortedWords.end(), [this](int lhs, int rhs) {
+                return m_words.at(lhs).text < m_words.at(rhs).text;
+            });
+            m_sortedWordsDirty = false;
+        }
+
+        QVector<int>::const_iterator it =
+                std::lower_bound(m_sortedWords.constBegin(), m_sortedWords.constEnd(), token,
+                                 [this](int wordId, const QString &value) {
+            return m_words.at(wordId).text < value;
+        });
+
+        for(; it != m_sortedWords.constEnd(); ++it) {
+            const QString &word = m_words.at(*it).text;
+            if(!word.startsWith(token)) {
+                break;
+            }
+
+            qreal score = (word.size() == token.size()) ?
+                        1.0 : 0.6 + 0.3 * token.size() / word.size();
+            if(score > scores->value(*it)) {
+                scores->insert(*it, score);
+            }
+        }
+    }
+
+    /*!
+     * \brief Scores the words sharing trigrams with \a token.
+     *
+     * Fuzzy matches score between 0.2 and 0.5 depending on the trigrams
+     * similarity, and are only used for tokens of three or more characters.
+     */
+    void SearchIndex::fuzzyMatches(const QString &token, QHash<int, qreal> *scores) const
+    {
+        QVector<quint64> tokenTrigrams = trigrams(token);
+        if(tokenTrigrams.isEmpty()) {
+            return;
+        }
+
+        QHash<int, int> shared;
+        foreach(quint64 trigram, tokenTrigrams) {
+            foreach(int wordId, m_trigrams.value(trigram)) {
+                ++shared[wordId];
+            }
+        }
+
+        for(QHash<int, int>::const_iterator it = shared.constBegin(); it != shared.constEnd(); ++it) {
+            int wordTrigrams = qMax(1, m_words.at(it.key()).text.size() - 2);
+            qreal similarity = qreal(it.value()) / qMax(tokenTrigrams.size(), wordTrigrams);
+            if(similarity < FuzzyThreshold) {
+                continue;
+            }
+
+            qreal score = 0.5 * similarity;
+            if(score > scores->value(it.key())) {
+                scores->insert(it.key(), score);
+            }
+        }
+    }
+
+    //! \brief Splits \a text in lowercase words.
+    QStringList SearchIndex::tokenize(const QString &text)
+    {
+        QStringList tokens;
+        QString current;
+
+        foreach(const QChar &c, text) {
+            if(c.isLetterOrNumber()) {
+                current += c.toLower();
+            }
+            else if(!current.isEmpty()) {
+                tokens << current;
+                current.clear();
+            }
+        }
+
+        if(!current.isEmpty()) {
+            tokens << current;
+        }
+
+        return tokens;
+    }
+
+    //! \brief Returns the (unique) trigrams of \a word, packed as integers.
+    QVector<quint64> SearchIndex::trigrams(const QString &word)
+    {
+        QVector<quint64> result;
+
+        for(int i = 0; i + 2 < word.size(); ++i) {
+            quint64 trigram = (quint64(word.at(i).unicode()) << 32) |
+                    (quint64(word.at(i + 1).unicode()) << 16) |
+                    quint64(word.at(i + 2).unicode());
+            if(!result.contains(trigram)) {
+                result << trigram;
+            }
+        }
+
+        return result;
+    }
+
+} // namespace Caneda
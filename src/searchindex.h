@@ -0,0 +1,109 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace Caneda
+{
+    /*!
+     * \brief This class implements a fuzzy full text index, used to search
+     * components in the component browsers.
+     *
+     * Each document is made of a name and a free text (for example the
+     * component's display text, description and model keywords). Documents
+     * are split in lowercase words, and each word is indexed both in a sorted
+     * list (for prefix lookups) and by its trigrams (for fuzzy lookups). In
+     * this way, a search only visits the words sharing some prefix or
+     * trigram with the query, instead of matching every document.
+     *
+     * Search results are ranked: exact word matches score higher than prefix
+     * matches, which in turn score higher than fuzzy (trigram) matches. Words
+     * in the document name weight more than words in the free text. All query
+     * words must match for a document to be returned.
+     *
+     * Removing a document purges its postings, and words left without
+     * postings are dropped. The ids of removed documents and words are
+     * reused by later insertions, so the index does not grow when the same
+     * documents are removed and inserted again (for example on library
+     * reloads).
+     *
+     * \sa SidebarItemsModel, FilterProxyModel
+     */
+    class SearchIndex
+    {
+    public:
+        SearchIndex();
+
+        int insert(const QString &name, const QString &text);
+        void remove(int id);
+        void clear();
+
+        QList<int> search(const QString &query) const;
+
+    private:
+        //! Occurrence of a word in a document.
+        struct Posting
+        {
+            int id;
+            int weight;
+        };
+
+        //! Indexed word, and the documents it appears in.
+        struct Word
+        {
+            QString text;
+            QVector<Posting> postings;
+        };
+
+        void addWords(int id, const QString &text, int weight);
+        void removeWord(int wordId);
+        void prefixMatches(const QString &token, QHash<int, qreal> *scores) const;
+        void fuzzyMatches(const QString &token, QHash<int, qreal> *scores) const;
+
+        static QStringList tokenize(const QString &text);
+        static QVector<quint64> trigrams(const QString &word);
+
+        QVector<Word> m_words;
+        QHash<QString, int> m_wordIds;
+        //! Word ids sorted alphabetically, used for prefix lookups.
+        mutable QVector<int> m_sortedWords;
+        mutable bool m_sortedWordsDirty;
+        //! Trigram to word ids, used for fuzzy lookups.
+        QHash<quint64, QVector<int> > m_trigrams;
+
+        //! Words without postings, whose ids can be reused.
+        QVector<int> m_freeWords;
+
+        QVector<QString> m_names;
+        //! Word ids of each document, used to purge its postings on removal.
+        QVector<QVector<int> > m_documentWords;
+        //! Removed documents, whose ids can be reused.
+        QVector<int> m_freeIds;
+    };
+
+} // namespace Caneda
+
+#endif //SEARCH_INDEX_H
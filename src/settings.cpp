@@ -74,6 +74,10 @@ namespace Caneda
         defaultSettings["gui/hdl/comment"] = QVariant(QColor(Qt::red));
         defaultSettings["gui/hdl/system"] = QVariant(QColor(Qt::darkYellow));
 
+        defaultSettings["autosave/interval"] = QVariant(int(5));  // In minutes, 0 disables autosave
+
+        defaultSettings["undo/undoLimit"] = QVariant(int(0));  // In undo steps, 0 means unlimited
+
         defaultSettings["sim/simulationEngine"] = QVariant(QString("ngspice"));  //! \todo In the future this could be replaced by an enum, to avoid problems
         defaultSettings["sim/simulationCommand"] = QVariant(QString("ngspice -b -r %filename.raw %filename.net"));
         defaultSettings["sim/outputFormat"] = QVariant(QString("binary"));  //! \todo In the future this could be replaced by an enum, to avoid problems
@@ -174,6 +178,8 @@ namespace Caneda
     /*!
      * \brief Set a new value for the selected setting.
      *
+     * If the value actually changes, currentValueChanged() is emitted.
+     *
      * \param key Setting to change its value.
      * \param value New value of the setting.
      *
@@ -181,7 +187,13 @@ namespace Caneda
      */
     void Settings::setCurrentValue(const QString& key, const QVariant& value)
     {
-        currentSettings[key] = value.isValid() ? value : defaultSettings[key];
+        const QVariant newValue = value.isValid() ? value : defaultSettings[key];
+        if (currentSettings.value(key) == newValue) {
+            return;
+        }
+
+        currentSettings[key] = newValue;
+        emit currentValueChanged(key);
     }
 
     /*!
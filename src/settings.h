@@ -55,6 +55,10 @@ namespace Caneda
         bool load();
         bool save();
 
+    Q_SIGNALS:
+        //! \brief Emitted when the current value of a setting changes.
+        void currentValueChanged(const QString &key);
+
     private:
         explicit Settings(QObject *parent = nullptr);
 
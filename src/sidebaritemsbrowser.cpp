@@ -19,17 +19,116 @@
 
 #include "sidebaritemsbrowser.h"
 
+#include "global.h"
 #include "library.h"
+#include "librarycache.h"
 #include "modelviewhelpers.h"
+#include "settings.h"
 
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFutureWatcher>
 #include <QHeaderView>
 #include <QKeyEvent>
 #include <QLineEdit>
+#include <QPainter>
+#include <QStandardPaths>
 #include <QTreeView>
 #include <QVBoxLayout>
+#include <QtConcurrent>
+#include <QtMath>
 
 namespace Caneda
 {
+    //! \brief Item data role holding the search index id of an item.
+    static const int SearchIdRole = Qt::UserRole + 1;
+
+    /*************************************************************************
+     *                          SymbolIconRenderer                           *
+     *************************************************************************/
+    /*!
+     * \brief Functor used to render the icon of a symbol file in a worker
+     * thread.
+     *
+     * Rendered icons are kept in a persistent cache in the user's cache
+     * directory, keyed by a hash of the symbol file contents and the pen used
+     * to render it. In this way, a symbol is rendered only once, until its
+     * file is modified.
+     *
+     * Symbols are not parsed from their files (symbol paintings may only be
+     * created from the gui thread). Instead, the symbol drawing is decoded
+     * from the compiled data of the library cache, and rendered into a
+     * QImage, entirely in the worker thread.
+     */
+    struct SymbolIconRenderer
+    {
+        //! Symbol to render, with its compiled data from the library cache.
+        struct Symbol
+        {
+            QString filePath;
+            QByteArray compiledData;
+        };
+
+        typedef QImage result_type;
+
+        //! Maximum size of the rendered icons.
+        static const int IconSize = 48;
+
+        explicit SymbolIconRenderer(const QPen &pen) : m_pen(pen) {}
+
+        QImage operator()(const Symbol &symbol) const
+        {
+            QFile file(symbol.filePath);
+            if(!file.open(QIODevice::ReadOnly)) {
+                return QImage();
+            }
+
+            // Check the icons cache first
+            QCryptographicHash hash(QCryptographicHash::Sha1);
+            hash.addData(&file);
+            hash.addData(m_pen.color().name(QColor::HexArgb).toLatin1());
+            hash.addData(QByteArray::number(m_pen.width()));
+            file.close();
+
+            QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/icons";
+            QString cacheFile = cacheDir + "/" + QString::fromLatin1(hash.result().toHex()) + ".png";
+
+            QImage image;
+            if(image.load(cacheFile)) {
+                return image;
+            }
+
+            // Decode the compiled symbol and render it
+            QPainterPath path = LibraryCache::decompileSymbol(symbol.compiledData);
+            if(path.isEmpty()) {
+                return QImage();
+            }
+
+            QRectF rect = path.boundingRect().adjusted(-1.0, -1.0, 1.0, 1.0);
+            qreal scale = qMin(1.0, IconSize / qMax(rect.width(), rect.height()));
+
+            image = QImage(qCeil(rect.width() * scale), qCeil(rect.height() * scale),
+                           QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+
+            QPainter painter(&image);
+            painter.setRenderHints(Caneda::DefaulRenderHints);
+            painter.setPen(m_pen);
+            painter.scale(scale, scale);
+            painter.translate(-rect.topLeft());
+            painter.drawPath(path);
+            painter.end();
+
+            QDir().mkpath(cacheDir);
+            image.save(cacheFile);
+
+            return image;
+        }
+
+        QPen m_pen;
+    };
+
     /*************************************************************************
      *                          SidebarItemsModel                            *
      *************************************************************************/
@@ -66,6 +165,7 @@ namespace Caneda
         while(it != end) {
             QStandardItem *item = new QStandardItem(QIcon(it->second), it->first);
             catItem->appendRow(item);
+            indexItem(item, QString());
             ++it;
         }
     }
@@ -80,7 +180,7 @@ namespace Caneda
     {
         // Get the library indicated by libraryName.
         LibraryManager *manager = LibraryManager::instance();
-        const Library *libItem = manager->library(libraryName);
+        Library *libItem = manager->library(libraryName);
 
         if(!libItem) {
             return;
@@ -102,15 +202,7 @@ namespace Caneda
         QStandardItem *libRoot = new QStandardItem(libItem->libraryName());
         catItem->appendRow(libRoot);
 
-        // Get the components list and plug each one into the tree
-        QStringList components(libItem->componentsList());
-
-        foreach(const QString component, components) {
-            ComponentDataPtr data = libItem->component(component);
-            QIcon icon = QIcon(manager->pixmapCache(data->name, data->library));
-            QStandardItem *item = new QStandardItem(icon, data->name);
-            libRoot->appendRow(item);
-        }
+        plugComponents(libItem, libRoot);
     }
 
     /*!
@@ -121,17 +213,140 @@ namespace Caneda
      */
     void SidebarItemsModel::unPlugLibrary(QString libraryName, QString category)
     {
-        // Search the category
-        if(!findItems(category).isEmpty()) {
+        QStandardItem *libRoot = libraryItem(libraryName, category);
+        if(libRoot) {
+            // Remove the library and its components from the search index
+            unPlugComponents(libRoot);
+            libRoot->parent()->removeRow(libRoot->row());
+        }
+    }
 
-            QStandardItem *catItem = findItems(category).first();
+    /*!
+     * \brief Updates the components of an already plugged library.
+     *
+     * This is used when the library components change on disk. The library
+     * keeps its place in the tree, and only its components are plugged again
+     * (icons of unchanged symbols are taken from the icons disk cache).
+     *
+     * \param libraryName Library name to update.
+     * \param category Category of the library to be updated.
+     */
+    void SidebarItemsModel::reloadLibrary(QString libraryName, QString category)
+    {
+        Library *libItem = LibraryManager::instance()->library(libraryName);
+        QStandardItem *libRoot = libraryItem(libraryName, category);
+        if(!libItem || !libRoot) {
+            return;
+        }
+
+        unPlugComponents(libRoot);
+        libRoot->removeRows(0, libRoot->rowCount());
+        plugComponents(libItem, libRoot);
+    }
+
+    //! \brief Plugs the components of a library under its root item.
+    void SidebarItemsModel::plugComponents(Library *libItem, QStandardItem *libRoot)
+    {
+        // Get the components list and plug each one into the tree, with a
+        // placeholder icon until its symbol icon is rendered
+        QStringList components(libItem->componentsList());
+        QIcon placeholder = Caneda::icon("application-x-caneda-symbol");
+
+        QList<SymbolIconRenderer::Symbol> symbols;
+        QList<QPersistentModelIndex> indexes;
+        foreach(const QString component, components) {
+            QStandardItem *item = new QStandardItem(placeholder, component);
+            libRoot->appendRow(item);
+            indexItem(item, libItem->componentDisplayText(component) + " " +
+                      libItem->componentKeywords(component));
+
+            SymbolIconRenderer::Symbol symbol;
+            symbol.filePath = libItem->componentFilePath(component);
+            symbol.compiledData = libItem->componentCompiledData(component);
+            symbols << symbol;
+            indexes << QPersistentModelIndex(item->index());
+        }
 
-            // If found the category, search the library
-            if(!findItems(libraryName, Qt::MatchExactly, catItem->column()).isEmpty()) {
-                // Remove the library
-                QStandardItem *library = findItems(libraryName, Qt::MatchExactly, catItem->column()).first();
-                catItem->removeRow(library->row());
+        // Render the icons in worker threads
+        Settings *settings = Settings::instance();
+        QPen pen(settings->currentValue("gui/lineColor").value<QColor>(),
+                 settings->currentValue("gui/lineWidth").toInt());
+
+        QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+        connect(watcher, &QFutureWatcherBase::resultReadyAt, this, [=](int index) {
+            // The library may have been unplugged meanwhile
+            QImage image = watcher->resultAt(index);
+            QStandardItem *item = itemFromIndex(indexes.at(index));
+            if(item && !image.isNull()) {
+                item->setIcon(QIcon(QPixmap::fromImage(image)));
             }
+        });
+        connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+        watcher->setFuture(QtConcurrent::mapped(symbols, SymbolIconRenderer(pen)));
+    }
+
+    //! \brief Removes the components of a library root item from the search index.
+    void SidebarItemsModel::unPlugComponents(QStandardItem *libRoot)
+    {
+        for(int i = 0; i < libRoot->rowCount(); ++i) {
+            QVariant id = libRoot->child(i)->data(SearchIdRole);
+            if(id.isValid()) {
+                m_searchIndex.remove(id.toInt());
+                m_searchItems[id.toInt()] = QPersistentModelIndex();
+            }
+        }
+    }
+
+    //! \brief Returns the root item of a plugged library, or nullptr if not found.
+    QStandardItem* SidebarItemsModel::libraryItem(const QString &libraryName, const QString &category) const
+    {
+        QList<QStandardItem*> categories = findItems(category);
+        if(categories.isEmpty()) {
+            return nullptr;
+        }
+
+        QStandardItem *catItem = categories.first();
+        for(int i = 0; i < catItem->rowCount(); ++i) {
+            if(catItem->child(i)->text() == libraryName) {
+                return catItem->child(i);
+            }
+        }
+
+        return nullptr;
+    }
+
+    /*!
+     * \brief Searches the model items.
+     *
+     * \param text Text to search, in one or more words.
+     * \return Indexes of the matching items, best ranked first.
+     *
+     * \sa SearchIndex
+     */
+    QList<QPersistentModelIndex> SidebarItemsModel::search(const QString &text) const
+    {
+        QList<QPersistentModelIndex> results;
+        foreach(int id, m_searchIndex.search(text)) {
+            if(m_searchItems.at(id).isValid()) {
+                results << m_searchItems.at(id);
+            }
+        }
+
+        return results;
+    }
+
+    //! \brief Adds an already plugged item to the search index.
+    void SidebarItemsModel::indexItem(QStandardItem *item, const QString &text)
+    {
+        int id = m_searchIndex.insert(item->text(), text);
+        item->setData(id, SearchIdRole);
+
+        // Ids of removed items are reused by the search index
+        if(id < m_searchItems.size()) {
+            m_searchItems[id] = QPersistentModelIndex(item->index());
+        }
+        else {
+            m_searchItems << QPersistentModelIndex(item->index());
         }
     }
 
@@ -139,7 +354,7 @@ namespace Caneda
      *                       SidebarItemsBrowser                             *
      *************************************************************************/
     //! \brief Constructor.
-    SidebarItemsBrowser::SidebarItemsBrowser(QStandardItemModel *model,
+    SidebarItemsBrowser::SidebarItemsBrowser(SidebarItemsModel *model,
                                              QWidget *parent) :
         QWidget(parent),
         m_model(model)
@@ -159,6 +374,9 @@ namespace Caneda
         m_proxyModel->setSortCaseSensitivity(Qt::CaseInsensitive);
         m_proxyModel->setSourceModel(m_model);
 
+        // Search results are shown in a flat list instead of the tree
+        m_resultsModel = new SearchResultsModel(this);
+
         // Create view, set its properties and proxy model
         m_treeView = new QTreeView(this);
         m_treeView->header()->hide();
@@ -194,7 +412,7 @@ namespace Caneda
                 if(keyEvent->key() == Qt::Key_Down) {
                     // Set the row next to the currently selected one
                     int index = m_treeView->currentIndex().row() + 1;
-                    m_treeView->setCurrentIndex(m_proxyModel->index(index,0));
+                    m_treeView->setCurrentIndex(m_treeView->model()->index(index,0));
                     m_treeView->setFocus();
 
                     return true;
@@ -207,21 +425,34 @@ namespace Caneda
         return QWidget::eventFilter(object, event);
     }
 
-    //! \brief Filters items according to user input on a QLineEdit.
+    /*!
+     * \brief Filters items according to user input on a QLineEdit.
+     *
+     * While searching, the view shows the ranked search results as a flat
+     * list, so only the results are visited on each keystroke. The tree is
+     * shown back once the search text is cleared.
+     */
     void SidebarItemsBrowser::filterTextChanged()
     {
         QString text = m_filterEdit->text();
-        QRegExp regExp(text, Qt::CaseInsensitive, QRegExp::RegExp);
-        m_proxyModel->setFilterRegExp(regExp);
-        m_treeView->expandAll();
+        if(text.trimmed().isEmpty()) {
+            m_resultsModel->setResults(QList<QPersistentModelIndex>());
+            setViewModel(m_proxyModel);
+        }
+        else {
+            m_resultsModel->setResults(m_model->search(text));
+            setViewModel(m_resultsModel);
+        }
     }
 
     //! \brief Emits the component and category clicked on the model.
     void SidebarItemsBrowser::itemClicked(const QModelIndex& index)
     {
         if(index.isValid()) {
-            QStandardItem *currentItem = m_model->itemFromIndex(
-                        m_proxyModel->mapToSource(index));
+            QStandardItem *currentItem = m_model->itemFromIndex(sourceIndex(index));
+            if(!currentItem) {
+                return;
+            }
 
             QString item = currentItem->text();
             QString category = currentItem->parent() ? currentItem->parent()->text() : "root";
@@ -230,4 +461,30 @@ namespace Caneda
         }
     }
 
+    //! \brief Shows \a model (the tree or the search results) in the view.
+    void SidebarItemsBrowser::setViewModel(QAbstractItemModel *model)
+    {
+        if(m_treeView->model() == model) {
+            return;
+        }
+
+        // The view does not delete its previous selection model
+        QItemSelectionModel *selectionModel = m_treeView->selectionModel();
+        m_treeView->setModel(model);
+        delete selectionModel;
+
+        m_treeView->setRootIsDecorated(model == m_proxyModel);
+        m_treeView->expandAll();
+    }
+
+    //! \brief Maps an index of the view to the items model.
+    QModelIndex SidebarItemsBrowser::sourceIndex(const QModelIndex &index) const
+    {
+        if(m_treeView->model() == m_resultsModel) {
+            return m_resultsModel->sourceIndex(index);
+        }
+
+        return m_proxyModel->mapToSource(index);
+    }
+
 } // namespace Caneda
@@ -20,7 +20,10 @@
 #ifndef SIDEBAR_ITEMS_BROWSER_H
 #define SIDEBAR_ITEMS_BROWSER_H
 
+#include "searchindex.h"
+
 #include <QPair>
+#include <QPersistentModelIndex>
 #include <QStandardItemModel>
 #include <QWidget>
 
@@ -33,6 +36,8 @@ namespace Caneda
 {
     // Forward declarations.
     class FilterProxyModel;
+    class Library;
+    class SearchResultsModel;
 
     /*!
      * \brief Model to provide the abstract interface for library tree items.
@@ -47,6 +52,15 @@ namespace Caneda
      * underlying data model is exposed as a simple tree of rows and columns.
      * Each item has a unique index specified by a QModelIndex.
      *
+     * Library components are plugged with a placeholder icon, and their
+     * symbol icons are rendered on worker threads (see SymbolIconRenderer) and
+     * set as they are ready. In this way, plugging large libraries never
+     * blocks the gui.
+     *
+     * All plugged items are also added to a SearchIndex, with their names,
+     * display texts, descriptions and model keywords, which is used by the
+     * views to filter the model (see search()).
+     *
      * \sa QStandardItemModel, SidebarItemsBrowser
      */
     class SidebarItemsModel : public QStandardItemModel
@@ -59,6 +73,19 @@ namespace Caneda
         void plugItems(const QList<QPair<QString, QPixmap> > &items, QString category);
         void plugLibrary(QString libraryName, QString category);
         void unPlugLibrary(QString libraryName, QString category);
+        void reloadLibrary(QString libraryName, QString category);
+
+        QList<QPersistentModelIndex> search(const QString &text) const;
+
+    private:
+        void plugComponents(Library *libItem, QStandardItem *libRoot);
+        void unPlugComponents(QStandardItem *libRoot);
+        QStandardItem* libraryItem(const QString &libraryName, const QString &category) const;
+        void indexItem(QStandardItem *item, const QString &text);
+
+        SearchIndex m_searchIndex;
+        //! Model index of each search index document.
+        QList<QPersistentModelIndex> m_searchItems;
     };
 
     /*!
@@ -83,7 +110,7 @@ namespace Caneda
         Q_OBJECT
 
     public:
-        explicit SidebarItemsBrowser(QStandardItemModel *model, QWidget *parent = nullptr);
+        explicit SidebarItemsBrowser(SidebarItemsModel *model, QWidget *parent = nullptr);
         ~SidebarItemsBrowser() override;
 
     Q_SIGNALS:
@@ -99,8 +126,12 @@ namespace Caneda
         void itemClicked(const QModelIndex& index);
 
     private:
-        QStandardItemModel *m_model;
+        void setViewModel(QAbstractItemModel *model);
+        QModelIndex sourceIndex(const QModelIndex &index) const;
+
+        SidebarItemsModel *m_model;
         FilterProxyModel *m_proxyModel;
+        SearchResultsModel *m_resultsModel;
         QTreeView *m_treeView;
 
         QLineEdit *m_filterEdit;
@@ -57,6 +57,9 @@ namespace Caneda
         m_proxyModel->setSortCaseSensitivity(Qt::CaseInsensitive);
         m_proxyModel->setSourceModel(m_model);
 
+        // Search results are shown in a flat list instead of the tree
+        m_resultsModel = new SearchResultsModel(this);
+
         // Create view, set properties and proxy model
         m_treeView = new QTreeView(this);
         m_treeView->header()->hide();
@@ -88,11 +91,12 @@ namespace Caneda
                 if(keyEvent->key() == Qt::Key_Down) {
 
                     // Set the row next to the currently selected one
-                    if(m_treeView->currentIndex() == m_proxyModel->index(0,0)) {
-                        m_treeView->setCurrentIndex(m_treeView->model()->index(0,0, m_treeView->rootIndex()));
+                    QAbstractItemModel *model = m_treeView->model();
+                    if(m_treeView->currentIndex() == model->index(0,0)) {
+                        m_treeView->setCurrentIndex(model->index(0,0, m_treeView->rootIndex()));
                     }
                     else {
-                        m_treeView->setCurrentIndex(m_proxyModel->index(0,0));
+                        m_treeView->setCurrentIndex(model->index(0,0));
                     }
 
                     // Set the focus in the treeview
@@ -108,14 +112,23 @@ namespace Caneda
         return QMenu::eventFilter(object, event);
     }
 
-    //! \brief Filters actions according to user input on a QLineEdit.
+    /*!
+     * \brief Filters actions according to user input on a QLineEdit.
+     *
+     * \copydetails SidebarItemsBrowser::filterTextChanged()
+     */
     void QuickInsert::filterTextChanged()
     {
         QString text = m_filterEdit->text();
-        QRegExp regExp(text, Qt::CaseInsensitive, QRegExp::RegExp);
-        m_proxyModel->setFilterRegExp(regExp);
-        m_treeView->setCurrentIndex(m_proxyModel->index(0,0));
-        m_treeView->expandAll();
+        if(text.trimmed().isEmpty()) {
+            m_resultsModel->setResults(QList<QPersistentModelIndex>());
+            setViewModel(m_proxyModel);
+        }
+        else {
+            m_resultsModel->setResults(m_model->search(text));
+            setViewModel(m_resultsModel);
+        }
+        m_treeView->setCurrentIndex(m_treeView->model()->index(0,0));
     }
 
     //! \brief Accept the dialog and insert the selected action.
@@ -123,8 +136,11 @@ namespace Caneda
     {
         if(m_treeView->currentIndex().isValid()) {
 
-            QStandardItem *currentItem = m_model->itemFromIndex(
-                        m_proxyModel->mapToSource(m_treeView->currentIndex()));
+            QStandardItem *currentItem = m_model->itemFromIndex(sourceIndex(m_treeView->currentIndex()));
+            if(!currentItem) {
+                hide();
+                return;
+            }
 
             QString item = currentItem->text();
             QString category = currentItem->parent() ? currentItem->parent()->text() : "root";
@@ -135,4 +151,30 @@ namespace Caneda
         hide();
     }
 
+    //! \copydoc SidebarItemsBrowser::setViewModel()
+    void QuickInsert::setViewModel(QAbstractItemModel *model)
+    {
+        if(m_treeView->model() == model) {
+            return;
+        }
+
+        // The view does not delete its previous selection model
+        QItemSelectionModel *selectionModel = m_treeView->selectionModel();
+        m_treeView->setModel(model);
+        delete selectionModel;
+
+        m_treeView->setRootIsDecorated(model == m_proxyModel);
+        m_treeView->expandAll();
+    }
+
+    //! \copydoc SidebarItemsBrowser::sourceIndex()
+    QModelIndex QuickInsert::sourceIndex(const QModelIndex &index) const
+    {
+        if(m_treeView->model() == m_resultsModel) {
+            return m_resultsModel->sourceIndex(index);
+        }
+
+        return m_proxyModel->mapToSource(index);
+    }
+
 } // namespace Caneda
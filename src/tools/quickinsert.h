@@ -23,7 +23,9 @@
 #include <QMenu>
 
 // Forward declarations.
+class QAbstractItemModel;
 class QLineEdit;
+class QModelIndex;
 class QTreeView;
 class QWidget;
 
@@ -31,6 +33,7 @@ namespace Caneda
 {
     // Forward declarations.
     class FilterProxyModel;
+    class SearchResultsModel;
     class SidebarItemsModel;
 
     /*!
@@ -43,7 +46,7 @@ namespace Caneda
      * presentation part to the user, while SidebarItemsModel class handles the
      * data interaction itself.
      *
-     * \sa SidebarItemsModel, QSortFilterProxyModel
+     * \sa SidebarItemsModel, QSortFilterProxyModel, SearchResultsModel
      */
     class QuickInsert : public QMenu
     {
@@ -63,8 +66,12 @@ namespace Caneda
         void insertItem();
 
     private:
+        void setViewModel(QAbstractItemModel *model);
+        QModelIndex sourceIndex(const QModelIndex &index) const;
+
         SidebarItemsModel *m_model;
         FilterProxyModel *m_proxyModel;
+        SearchResultsModel *m_resultsModel;
         QTreeView *m_treeView;
 
         QLineEdit *m_filterEdit;
@@ -26,8 +26,36 @@
 #include "wire.h"
 #include "xmlutilities.h"
 
+#include <QDateTime>
+
 namespace Caneda
 {
+    /*!
+     * \brief Maximum time (in milliseconds) between two commands acting on the
+     * same object for them to be merged into a single undo step.
+     */
+    static const qint64 MergeInterval = 2000;
+
+    //! \brief Returns the current time, used to timestamp mergeable commands.
+    static qint64 currentTime()
+    {
+        return QDateTime::currentMSecsSinceEpoch();
+    }
+
+    /*!
+     * \brief Returns true if \a port still belongs to its parent item.
+     *
+     * Ports dropped when reloading a component from its library are retired
+     * instead of deleted, as they may be referenced by the undo history.
+     * Their connections must not be restored.
+     *
+     * \sa Component::updateComponentData()
+     */
+    static bool isLivePort(Port *port)
+    {
+        return port->parentItem()->ports().contains(port);
+    }
+
     /*************************************************************************
      *                            MoveItemCmd                                *
      *************************************************************************/
@@ -49,7 +77,8 @@ namespace Caneda
         QUndoCommand(parent),
         m_item(item),
         m_initialPos(init),
-        m_finalPos(end)
+        m_finalPos(end),
+        m_time(currentTime())
     {
     }
 
@@ -101,6 +130,88 @@ namespace Caneda
         }
     }
 
+    /*!
+     * \brief Merges a following move of the same item into this command.
+     *
+     * QUndoStack calls this method when a command with the same id() is
+     * pushed right after this one. Consecutive moves of an item are merged,
+     * keeping the initial position of this command and the final position of
+     * \a other.
+     *
+     * \return True if \a other was merged (and is to be deleted).
+     */
+    bool MoveItemCmd::mergeWith(const QUndoCommand *other)
+    {
+        const MoveItemCmd *move = static_cast<const MoveItemCmd*>(other);
+        if(move->m_item != m_item || move->m_initialPos != m_finalPos ||
+                move->m_time - m_time > MergeInterval) {
+            return false;
+        }
+
+        m_finalPos = move->m_finalPos;
+        m_time = move->m_time;
+        return true;
+    }
+
+
+    /*************************************************************************
+     *                            MoveItemsCmd                               *
+     *************************************************************************/
+    //! \copydoc MoveItemCmd::MoveItemCmd()
+    MoveItemsCmd::MoveItemsCmd(const QList<GraphicsItem*> &items,
+                               const QPointF &delta,
+                               const QList<PortPair> &disconnections,
+                               const QList<WireStretch> &stretchedWires,
+                               GraphicsScene *scene,
+                               QUndoCommand *parent) :
+        QUndoCommand(parent),
+        m_items(items),
+        m_delta(delta),
+        m_disconnections(disconnections),
+        m_stretchedWires(stretchedWires),
+        m_scene(scene)
+    {
+    }
+
+    //! \copydoc MoveItemCmd::undo()
+    void MoveItemsCmd::undo()
+    {
+        m_scene->moveItems(m_items, -m_delta);
+
+        // Stretched wires must coincide again with the moved ports before
+        // reconnecting, or they would be disconnected from them
+        foreach(const WireStretch &stretch, m_stretchedWires) {
+            stretch.wire->movePort1(stretch.oldLine.p1());
+            stretch.wire->movePort2(stretch.oldLine.p2());
+        }
+
+        m_scene->reconnectItems(m_items);
+
+        foreach(const PortPair &pair, m_disconnections) {
+            if(isLivePort(pair.first) && isLivePort(pair.second) &&
+                    !pair.first->isConnectedTo(pair.second)) {
+                pair.first->connectTo(pair.second);
+            }
+        }
+    }
+
+    //! \copydoc MoveItemCmd::redo()
+    void MoveItemsCmd::redo()
+    {
+        foreach(const PortPair &pair, m_disconnections) {
+            pair.first->disconnect();
+        }
+
+        m_scene->moveItems(m_items, m_delta);
+
+        foreach(const WireStretch &stretch, m_stretchedWires) {
+            stretch.wire->movePort1(stretch.newLine.p1());
+            stretch.wire->movePort2(stretch.newLine.p2());
+        }
+
+        m_scene->reconnectItems(m_items);
+    }
+
 
     /*************************************************************************
      *                           DisconnectCmd                               *
@@ -116,7 +227,9 @@ namespace Caneda
     //! \copydoc MoveItemCmd::undo()
     void DisconnectCmd::undo()
     {
-        m_port1->connectTo(m_port2);
+        if(isLivePort(m_port1) && isLivePort(m_port2)) {
+            m_port1->connectTo(m_port2);
+        }
     }
 
     //! \copydoc MoveItemCmd::redo()
@@ -163,15 +276,31 @@ namespace Caneda
         QUndoCommand(parent),
         m_item(item),
         m_scene(scene),
-        m_pos(pos)
+        m_pos(pos),
+        m_done(false)
     {
     }
 
+    /*!
+     * \brief Destructor.
+     *
+     * The command owns the item while it is undone (that is, while the item
+     * is out of the scene). This happens when the command is dropped from the
+     * redo side of the undo stack, or when the whole stack is destroyed.
+     */
+    InsertItemCmd::~InsertItemCmd()
+    {
+        if(!m_done && !m_item->scene() && !m_item->parentItem()) {
+            delete m_item;
+        }
+    }
+
     //! \copydoc MoveItemCmd::undo()
     void InsertItemCmd::undo()
     {
         m_scene->disconnectItems(m_item);
         m_scene->removeItem(m_item);
+        m_done = false;
     }
 
     //! \copydoc MoveItemCmd::redo()
@@ -181,6 +310,7 @@ namespace Caneda
         m_item->setPos(m_pos);
         m_scene->connectItems(m_item);
         m_scene->splitAndCreateNodes(m_item);
+        m_done = true;
     }
 
 
@@ -192,21 +322,51 @@ namespace Caneda
                                    GraphicsScene *scene,
                                    QUndoCommand *parent) :
         QUndoCommand(parent),
-        m_scene(scene)
+        m_scene(scene),
+        m_done(false)
     {
         foreach(GraphicsItem *item, items) {
             m_itemPointPairs << ItemPointPair(item, item->pos());
         }
     }
 
+    /*!
+     * \brief Destructor.
+     *
+     * The command owns the removed items while it is applied, and deletes
+     * them when it is dropped from the undo history. Otherwise, deleted items
+     * would be kept alive until the document is closed.
+     */
+    RemoveItemsCmd::~RemoveItemsCmd()
+    {
+        if(!m_done) {
+            return;
+        }
+
+        // Child items are deleted along with their parents
+        QList<GraphicsItem*> orphans;
+        foreach(const ItemPointPair &p, m_itemPointPairs) {
+            if(!p.first->scene() && !p.first->parentItem()) {
+                orphans << p.first;
+            }
+        }
+
+        qDeleteAll(orphans);
+    }
+
     //! \copydoc MoveItemCmd::undo()
     void RemoveItemsCmd::undo()
     {
+        QList<GraphicsItem*> items;
         foreach(ItemPointPair p, m_itemPointPairs) {
             m_scene->addItem(p.first);
             p.first->setPos(p.second);
-            m_scene->connectItems(p.first);
+            items << p.first;
         }
+
+        // Connect once all items are back, for the whole set
+        m_scene->connectItems(items);
+        m_done = false;
     }
 
     //! \copydoc MoveItemCmd::redo()
@@ -216,6 +376,7 @@ namespace Caneda
             m_scene->disconnectItems(p.first);
             m_scene->removeItem(p.first);
         }
+        m_done = true;
     }
 
 
@@ -237,9 +398,6 @@ namespace Caneda
     //! \copydoc MoveItemCmd::undo()
     void RotateItemsCmd::undo()
     {
-        // Disconnect
-        m_scene->disconnectItems(m_items);
-
         // Rotate
         QPointF rotationCenter = m_scene->centerOfItems(m_items);
 
@@ -247,16 +405,13 @@ namespace Caneda
             item->rotate(m_dir == Caneda::Clockwise ? Caneda::AntiClockwise : Caneda::Clockwise, rotationCenter);
         }
 
-        // Reconnect
-        m_scene->connectItems(m_items);
+        // Reconnect the boundary of the rotated set
+        m_scene->reconnectItems(m_items);
     }
 
     //! \copydoc MoveItemCmd::redo()
     void RotateItemsCmd::redo()
     {
-        // Disconnect
-        m_scene->disconnectItems(m_items);
-
         // Rotate
         QPointF rotationCenter = m_scene->centerOfItems(m_items);
 
@@ -264,8 +419,8 @@ namespace Caneda
             item->rotate(m_dir, rotationCenter);
         }
 
-        // Reconnect
-        m_scene->connectItems(m_items);
+        // Reconnect the boundary of the rotated set
+        m_scene->reconnectItems(m_items);
     }
 
 
@@ -293,9 +448,6 @@ namespace Caneda
     //! \copydoc MoveItemCmd::redo()
     void MirrorItemsCmd::redo()
     {
-        // Disconnect item before mirroring
-        m_scene->disconnectItems(m_items);
-
         // Mirror
         QPointF mirrorCenter = m_scene->centerOfItems(m_items);
 
@@ -303,8 +455,8 @@ namespace Caneda
             item->mirror(m_axis, mirrorCenter);
         }
 
-        // Reconnect
-        m_scene->connectItems(m_items);
+        // Reconnect the boundary of the mirrored set
+        m_scene->reconnectItems(m_items);
     }
 
 
@@ -319,7 +471,8 @@ namespace Caneda
         QUndoCommand(parent),
         m_painting(painting),
         m_oldRect(oldRect),
-        m_newRect(newRect)
+        m_newRect(newRect),
+        m_time(currentTime())
     {
     }
 
@@ -335,6 +488,25 @@ namespace Caneda
         m_painting->setPaintingRect(m_newRect);
     }
 
+    /*!
+     * \brief Merges a following resize of the same painting into this
+     * command.
+     *
+     * \sa MoveItemCmd::mergeWith()
+     */
+    bool ChangePaintingRectCmd::mergeWith(const QUndoCommand *other)
+    {
+        const ChangePaintingRectCmd *resize = static_cast<const ChangePaintingRectCmd*>(other);
+        if(resize->m_painting != m_painting || resize->m_oldRect != m_newRect ||
+                resize->m_time - m_time > MergeInterval) {
+            return false;
+        }
+
+        m_newRect = resize->m_newRect;
+        m_time = resize->m_time;
+        return true;
+    }
+
 
     /*************************************************************************
      *                       ChangePaintingPropertyCmd                       *
@@ -429,7 +601,8 @@ namespace Caneda
         QUndoCommand(parent),
         m_propertyGroup(propGroup),
         m_oldMap(old),
-        m_newMap(newMap)
+        m_newMap(newMap),
+        m_time(currentTime())
     {
     }
 
@@ -445,4 +618,23 @@ namespace Caneda
         m_propertyGroup->setPropertyMap(m_newMap);
     }
 
+    /*!
+     * \brief Merges a following property change of the same group into this
+     * command.
+     *
+     * \sa MoveItemCmd::mergeWith()
+     */
+    bool ChangePropertyMapCmd::mergeWith(const QUndoCommand *other)
+    {
+        const ChangePropertyMapCmd *change = static_cast<const ChangePropertyMapCmd*>(other);
+        if(change->m_propertyGroup != m_propertyGroup || change->m_oldMap != m_newMap ||
+                change->m_time - m_time > MergeInterval) {
+            return false;
+        }
+
+        m_newMap = change->m_newMap;
+        m_time = change->m_time;
+        return true;
+    }
+
 } // namespace Caneda
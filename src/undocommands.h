@@ -24,6 +24,7 @@
 #include "global.h"
 #include "property.h"
 
+#include <QLineF>
 #include <QPair>
 #include <QUndoCommand>
 
@@ -38,6 +39,31 @@ namespace Caneda
     class Wire;
 
     typedef QPair<GraphicsItem*, QPointF> ItemPointPair;
+    typedef QPair<Port*, Port*> PortPair;
+
+    //! \brief Scene geometry of an unselected wire stretched by a move.
+    struct WireStretch
+    {
+        Wire *wire;
+        //! Wire ends before the move, in scene coordinates.
+        QLineF oldLine;
+        //! Wire ends after the move, in scene coordinates.
+        QLineF newLine;
+    };
+
+    /*!
+     * \brief Identifiers of the commands that can be merged.
+     *
+     * Consecutive commands with the same identifier, acting on the same
+     * object, are merged into a single undo step by QUndoStack.
+     *
+     * \sa QUndoCommand::id(), QUndoCommand::mergeWith()
+     */
+    enum UndoCommandId {
+        MoveItemCmdId = 1,
+        ChangePaintingRectCmdId,
+        ChangePropertyMapCmdId
+    };
 
     /*!
      * \brief Move item command implementation of the QUndoCommand/QUndoStack
@@ -73,6 +99,10 @@ namespace Caneda
      * apply a change to a document with the redo() method and undo the change
      * with the undo() method. The implementations for these functions must be
      * provided in each derived class.
+     *
+     * Commands repeatedly applied to the same object in a short time (moves,
+     * painting resizes and property changes) implement id() and mergeWith(),
+     * so that they take a single entry in the undo history.
      */
     class MoveItemCmd : public QUndoCommand
     {
@@ -85,10 +115,50 @@ namespace Caneda
         void undo() override;
         void redo() override;
 
+        int id() const override { return MoveItemCmdId; }
+        bool mergeWith(const QUndoCommand *other) override;
+
     private:
         GraphicsItem *m_item;
         QPointF m_initialPos;
         QPointF m_finalPos;
+        qint64 m_time;
+    };
+
+    /*!
+     * \brief Move items command implementation of the QUndoCommand/QUndoStack
+     * pattern for Qt's Undo Framework.
+     *
+     * This command moves a set of items by the same delta, as when dragging a
+     * selection. Only the items, the delta, the connections broken when the
+     * move started and the geometry of the unselected wires stretched by the
+     * move are stored. The wires are restored before the connections of the
+     * whole set are recomputed, once, on each redo and undo.
+     *
+     * A whole drag gesture is recorded in a single command, so separate drags
+     * are never merged and remain separate undo steps.
+     *
+     * \copydetails MoveItemCmd
+     */
+    class MoveItemsCmd : public QUndoCommand
+    {
+    public:
+        explicit MoveItemsCmd(const QList<GraphicsItem*> &items,
+                              const QPointF &delta,
+                              const QList<PortPair> &disconnections,
+                              const QList<WireStretch> &stretchedWires,
+                              GraphicsScene *scene,
+                              QUndoCommand *parent = nullptr);
+
+        void undo() override;
+        void redo() override;
+
+    private:
+        QList<GraphicsItem*> m_items;
+        QPointF m_delta;
+        QList<PortPair> m_disconnections;
+        QList<WireStretch> m_stretchedWires;
+        GraphicsScene *const m_scene;
     };
 
     /*!
@@ -145,6 +215,8 @@ namespace Caneda
                                GraphicsScene *scene,
                                QUndoCommand *parent = nullptr);
 
+        ~InsertItemCmd() override;
+
         void undo() override;
         void redo() override;
 
@@ -152,6 +224,7 @@ namespace Caneda
         GraphicsItem *const m_item;
         GraphicsScene *const m_scene;
         QPointF m_pos;
+        bool m_done;
     };
 
     /*!
@@ -167,12 +240,15 @@ namespace Caneda
                                 GraphicsScene *scene,
                                 QUndoCommand *parent = nullptr);
 
+        ~RemoveItemsCmd() override;
+
         void undo() override;
         void redo() override;
 
     protected:
         QList<ItemPointPair> m_itemPointPairs;
         GraphicsScene *const m_scene;
+        bool m_done;
     };
 
     /*!
@@ -238,10 +314,14 @@ namespace Caneda
         void undo() override;
         void redo() override;
 
+        int id() const override { return ChangePaintingRectCmdId; }
+        bool mergeWith(const QUndoCommand *other) override;
+
     protected:
         Painting *const m_painting;
         QRectF m_oldRect;
         QRectF m_newRect;
+        qint64 m_time;
     };
 
     /*!
@@ -306,10 +386,14 @@ namespace Caneda
         void undo() override;
         void redo() override;
 
+        int id() const override { return ChangePropertyMapCmdId; }
+        bool mergeWith(const QUndoCommand *other) override;
+
     private:
         PropertyGroup *m_propertyGroup;
         PropertyMap m_oldMap;
         PropertyMap m_newMap;
+        qint64 m_time;
     };
 
 } // namespace Caneda
@@ -21,6 +21,7 @@
 #include "wire.h"
 
 #include "actionmanager.h"
+#include "graphicsscene.h"
 #include "settings.h"
 #include "xmlutilities.h"
 
@@ -31,6 +32,47 @@
 
 namespace Caneda
 {
+    //! \brief Returns the squared distance from \a point to the segment \a a, \a b.
+    static qreal squaredDistanceToSegment(const QPointF &point, const QPointF &a, const QPointF &b)
+    {
+        const QPointF ab = b - a;
+        const QPointF ap = point - a;
+        const qreal lengthSquared = QPointF::dotProduct(ab, ab);
+
+        qreal t = 0.0;
+        if(lengthSquared > 0.0) {
+            t = qBound(qreal(0.0), QPointF::dotProduct(ap, ab) / lengthSquared, qreal(1.0));
+        }
+
+        const QPointF d = ap - t * ab;
+        return QPointF::dotProduct(d, d);
+    }
+
+    //! \brief Returns the orientation of the triangle \a a, \a b, \a c (as a signed area).
+    static qreal orientation(const QPointF &a, const QPointF &b, const QPointF &c)
+    {
+        return (b.x() - a.x()) * (c.y() - a.y()) - (b.y() - a.y()) * (c.x() - a.x());
+    }
+
+    //! \brief Returns the squared distance between the segments \a a1, \a a2 and \a b1, \a b2.
+    static qreal squaredDistanceBetweenSegments(const QPointF &a1, const QPointF &a2,
+                                                const QPointF &b1, const QPointF &b2)
+    {
+        // Segments crossing each other
+        const qreal o1 = orientation(a1, a2, b1);
+        const qreal o2 = orientation(a1, a2, b2);
+        const qreal o3 = orientation(b1, b2, a1);
+        const qreal o4 = orientation(b1, b2, a2);
+        if(((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) &&
+                ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0))) {
+            return 0.0;
+        }
+
+        // Otherwise, the minimum distance is found at one of the endpoints
+        return qMin(qMin(squaredDistanceToSegment(a1, b1, b2), squaredDistanceToSegment(a2, b1, b2)),
+                    qMin(squaredDistanceToSegment(b1, a1, a2), squaredDistanceToSegment(b2, a1, a2)));
+    }
+
     /*!
      * \brief Constructs a wire between \a startPos and \a endPos.
      *
@@ -48,6 +90,7 @@ namespace Caneda
         setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
         setFlag(ItemSendsGeometryChanges, true);
         setFlag(ItemSendsScenePositionChanges, true);
+        setZValue(Caneda::WireZValue);
 
         // Set initial position
         setPos(startPos);
@@ -62,7 +105,11 @@ namespace Caneda
     //! \brief Destructor.
     Wire::~Wire()
     {
-        qDeleteAll(m_ports);
+        // The ports are taken out of the list first, as deleting a port
+        // updates the wire geometry, which is computed from the ports
+        const QList<Port*> ports = m_ports;
+        m_ports.clear();
+        qDeleteAll(ports);
     }
 
     /*!
@@ -82,6 +129,8 @@ namespace Caneda
      */
     void Wire::movePort1(const QPointF& newScenePos)
     {
+        // The scene must be informed before the bounding rect changes
+        prepareGeometryChange();
         port1()->setPos(mapFromScene(newScenePos));
         updateGeometry();
     }
@@ -89,27 +138,25 @@ namespace Caneda
     //! \copydoc movePort1()
     void Wire::movePort2(const QPointF& newScenePos)
     {
+        prepareGeometryChange();
         port2()->setPos(mapFromScene(newScenePos));
         updateGeometry();
     }
 
-    //! \brief Updates the wire's geometry and caches it.
+    /*!
+     * \brief Informs the scene of a change in the wire's geometry.
+     *
+     * The wire geometry is computed from its ports positions on demand, so
+     * only the scene's wire layer must be updated here.
+     *
+     * \sa GraphicsScene::updateWire()
+     */
     void Wire::updateGeometry()
     {
-        // Create a path for the shape using a QPainterPathStroker to allow for
-        // a thick selection band. Otherwise, if we use only a line, it is very
-        // difficult to make a wire selection. The last alternative is to use a
-        // QRect as a shape, but that would extend far off limits the selection
-        // of diagonal wires.
-        QPainterPath path;
-        path.moveTo(port1()->pos());
-        path.lineTo(port2()->pos());
-
-        QPainterPathStroker stroker;
-        stroker.setWidth(2*portRadius);
-        path = stroker.createStroke(path);
-
-        GraphicsItem::setShapeAndBoundRect(path, boundingRect());
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->updateWire(this);
+        }
     }
 
     //! \brief Returns bounding rectangle arround the wire
@@ -132,6 +179,71 @@ namespace Caneda
         return rect;
     }
 
+    /*!
+     * \brief Returns the shape of the wire.
+     *
+     * The shape is a thick band around the wire, to allow for an easy
+     * selection. Otherwise, if we use only a line, it is very difficult to
+     * make a wire selection. Using the bounding rect instead would extend far
+     * off limits the selection of diagonal wires.
+     *
+     * The path is built on each call, as it is only needed when testing
+     * against arbitrary paths (for example, during a rubber band selection).
+     * Hit-testing and collisions between wires use contains() and
+     * collidesWithItem() instead.
+     */
+    QPainterPath Wire::shape() const
+    {
+        QPainterPath path;
+        if(ports().isEmpty()) {
+            return path;
+        }
+
+        path.moveTo(port1()->pos());
+        path.lineTo(port2()->pos());
+
+        QPainterPathStroker stroker;
+        stroker.setWidth(2*portRadius);
+        stroker.setCapStyle(Qt::RoundCap);
+        return stroker.createStroke(path);
+    }
+
+    //! \brief Returns true if \a point (in item coordinates) is on the wire.
+    bool Wire::contains(const QPointF &point) const
+    {
+        if(ports().isEmpty()) {
+            return false;
+        }
+
+        return squaredDistanceToSegment(point, port1()->pos(), port2()->pos()) <=
+                portRadius * portRadius;
+    }
+
+    /*!
+     * \brief Returns true if the wire collides with \a other.
+     *
+     * Collisions between two wires are computed analytically, as the
+     * distance between both segments. Other items use the default shape
+     * based test.
+     */
+    bool Wire::collidesWithItem(const QGraphicsItem *other, Qt::ItemSelectionMode mode) const
+    {
+        const Wire *wire = (other && other->type() == Wire::Type) ?
+                    static_cast<const Wire*>(other) : nullptr;
+
+        if(!wire || mode != Qt::IntersectsItemShape ||
+                ports().isEmpty() || wire->ports().isEmpty()) {
+            return GraphicsItem::collidesWithItem(other, mode);
+        }
+
+        const QPointF a1 = port1()->pos();
+        const QPointF a2 = port2()->pos();
+        const QPointF b1 = mapFromItem(wire, wire->port1()->pos());
+        const QPointF b2 = mapFromItem(wire, wire->port2()->pos());
+
+        return squaredDistanceBetweenSegments(a1, a2, b1, b2) <= 4 * portRadius * portRadius;
+    }
+
     //! \brief Draw wire.
     void Wire::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
             QWidget *widget)
@@ -143,20 +255,34 @@ namespace Caneda
 
         // Set global pen settings
         Settings *settings = Settings::instance();
-        if(option->state & QStyle::State_Selected) {
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+        QColor color = (option->state & QStyle::State_Selected) ?
+                    settings->currentValue("gui/selectionColor").value<QColor>() :
+                    settings->currentValue("gui/lineColor").value<QColor>();
+
+        // When zoomed out, use a cosmetic aliased pen which is much cheaper to
+        // rasterize than a wide antialiased one
+        const bool outline = option->levelOfDetailFromTransform(painter->worldTransform()) < Caneda::LodOutlineThreshold;
+        const bool antialiased = painter->testRenderHint(QPainter::Antialiasing);
+
+        if(outline) {
+            painter->setPen(QPen(color, 0));
+            painter->setRenderHint(QPainter::Antialiasing, false);
         }
         else {
-            painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(QPen(color, settings->currentValue("gui/lineWidth").toInt()));
         }
 
         // Draw the wire
         painter->drawLine(port1()->pos(), port2()->pos());
 
+        if(outline) {
+            painter->setRenderHint(QPainter::Antialiasing, antialiased);
+        }
+
         // Restore pen
         painter->setPen(savedPen);
+
+        paintPorts(painter, option);
     }
 
     //! \copydoc GraphicsItem::copy()
@@ -202,8 +328,42 @@ namespace Caneda
                 break;
             }
         }
+    }
 
-        updateGeometry();
+    /*!
+     * \brief Keeps the scene's wire layer up to date.
+     *
+     * \sa GraphicsScene::updateWire(), WireLayer
+     */
+    QVariant Wire::itemChange(GraphicsItemChange change, const QVariant &value)
+    {
+        QVariant result = GraphicsItem::itemChange(change, value);
+
+        if(change == ItemSceneHasChanged) {
+            updateContentsFlag();
+        }
+        else if(change == ItemSelectedHasChanged) {
+            updateContentsFlag();
+            updateGeometry();
+        }
+        else if(change == ItemScenePositionHasChanged || change == ItemTransformHasChanged) {
+            updateGeometry();
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Sets whether the wire item paints itself.
+     *
+     * Unselected wires in a GraphicsScene are drawn by the scene's wire
+     * layer, so the item is flagged as having no contents, to avoid the
+     * per item painting overhead.
+     */
+    void Wire::updateContentsFlag()
+    {
+        const bool drawnByLayer = !isSelected() && qobject_cast<GraphicsScene*>(scene());
+        setFlag(ItemHasNoContents, drawnByLayer);
     }
 
     //! \copydoc GraphicsItem::contextMenuEvent()
@@ -35,6 +35,15 @@ namespace Caneda
      * can have one or multiple wire connections, allowing multiple components
      * to be connected together.
      *
+     * The wire geometry is analytic: its shape is a capsule of radius
+     * portRadius around the segment joining both ports. Hit-testing and
+     * collisions between wires are computed from the segment itself, so
+     * moving a wire endpoint (for example, while dragging a component with
+     * many attached wires) does not build any QPainterPath.
+     *
+     * While unselected, wires in a GraphicsScene are drawn together by the
+     * scene's WireLayer, and the wire items themselves paint nothing.
+     *
      * \sa GraphicsItem, Component, Port
      */
     class Wire : public GraphicsItem
@@ -45,6 +54,8 @@ namespace Caneda
 
         ~Wire() override;
 
+        CANEDA_POOLED_ALLOCATION(Wire)
+
         //! \copydoc GraphicsItem::Type
         enum { Type = GraphicsItem::WireType };
         //! \copydoc GraphicsItem::type()
@@ -67,6 +78,11 @@ namespace Caneda
 
         void updateGeometry();
         QRectF boundingRect() const override;
+        QPainterPath shape() const override;
+
+        bool contains(const QPointF &point) const override;
+        bool collidesWithItem(const QGraphicsItem *other,
+                              Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
 
         void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                    QWidget *widget = nullptr) override;
@@ -80,7 +96,11 @@ namespace Caneda
         void launchPropertiesDialog() override {}
 
     protected:
+        QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
         void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
+
+    private:
+        void updateContentsFlag();
     };
 
 } // namespace Caneda
@@ -0,0 +1,307 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "wirelayer.h"
+
+#include "global.h"
+#include "settings.h"
+#include "wire.h"
+
+#include <QLineF>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+namespace Caneda
+{
+    //! \brief Size of the spatial index cells, in scene units.
+    static const qreal CellSize = 256.0;
+
+    //! \brief Constructor.
+    WireLayer::WireLayer(QGraphicsItem *parent) :
+        QGraphicsItem(parent),
+        m_stamp(0)
+    {
+        setZValue(Caneda::WireZValue);
+        setAcceptedMouseButtons(Qt::NoButton);
+        setFlag(ItemUsesExtendedStyleOption, true);
+    }
+
+    //! \brief Adds a wire to the layer.
+    void WireLayer::insertWire(Wire *wire)
+    {
+        if(m_entries.contains(wire)) {
+            updateWire(wire);
+            return;
+        }
+
+        Entry entry;
+        entry.sceneRect = wire->sceneBoundingRect();
+        entry.cells = cellRange(entry.sceneRect);
+        entry.stamp = 0;
+
+        m_entries.insert(wire, entry);
+        addToCells(wire, entry.cells);
+
+        extendBoundingRect(entry.sceneRect);
+        update(entry.sceneRect);
+    }
+
+    /*!
+     * \brief Removes a wire from the layer.
+     *
+     * The wire itself is not accessed, so this may be called while the wire
+     * is being destroyed.
+     */
+    void WireLayer::removeWire(Wire *wire)
+    {
+        QHash<Wire*, Entry>::iterator it = m_entries.find(wire);
+        if(it == m_entries.end()) {
+            return;
+        }
+
+        const QRectF rect = it.value().sceneRect;
+        removeFromCells(wire, it.value().cells);
+        m_entries.erase(it);
+
+        update(rect);
+        shrinkBoundingRect(rect);
+    }
+
+    //! \brief Updates the indexed geometry of a wire, and redraws it.
+    void WireLayer::updateWire(Wire *wire)
+    {
+        QHash<Wire*, Entry>::iterator it = m_entries.find(wire);
+        if(it == m_entries.end()) {
+            return;
+        }
+
+        Entry &entry = it.value();
+        const QRectF oldRect = entry.sceneRect;
+        entry.sceneRect = wire->sceneBoundingRect();
+
+        const QRect cells = cellRange(entry.sceneRect);
+        if(cells != entry.cells) {
+            removeFromCells(wire, entry.cells);
+            addToCells(wire, cells);
+            entry.cells = cells;
+        }
+
+        const QRectF newRect = entry.sceneRect;
+        update(oldRect | newRect);
+        extendBoundingRect(newRect);
+        shrinkBoundingRect(oldRect);
+    }
+
+    //! \brief Returns the wires whose bounding rect intersects \a rect.
+    QVector<Wire*> WireLayer::wires(const QRectF &rect) const
+    {
+        QVector<Wire*> result;
+        const QRect cells = cellRange(rect);
+        ++m_stamp;
+
+        // Collects the wires of a cell not yet reported
+        auto collect = [&](const QVector<Wire*> &cellWires) {
+            foreach(Wire *wire, cellWires) {
+                const Entry &entry = m_entries.constFind(wire).value();
+                if(entry.stamp != m_stamp && entry.sceneRect.intersects(rect)) {
+                    entry.stamp = m_stamp;
+                    result << wire;
+                }
+            }
+        };
+
+        // When zoomed out, the rect may cover many more cells than the ones
+        // actually used, so only walk the used cells
+        if(qint64(cells.width()) * cells.height() > m_cells.size()) {
+            for(QHash<Cell, QVector<Wire*> >::const_iterator it = m_cells.constBegin();
+                    it != m_cells.constEnd(); ++it) {
+                if(cells.contains(it.key().first, it.key().second)) {
+                    collect(it.value());
+                }
+            }
+        }
+        else {
+            for(int x = cells.left(); x <= cells.right(); ++x) {
+                for(int y = cells.top(); y <= cells.bottom(); ++y) {
+                    QHash<Cell, QVector<Wire*> >::const_iterator it = m_cells.constFind(Cell(x, y));
+                    if(it != m_cells.constEnd()) {
+                        collect(it.value());
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    //! \brief Returns the union of the scene rects of all wires.
+    QRectF WireLayer::boundingRect() const
+    {
+        return m_boundingRect;
+    }
+
+    /*!
+     * \brief Returns an empty shape.
+     *
+     * The layer only draws the wires, which are found and selected through
+     * their own items, so the layer itself must never be hit.
+     */
+    QPainterPath WireLayer::shape() const
+    {
+        return QPainterPath();
+    }
+
+    /*!
+     * \brief Draws the unselected wires in the exposed area.
+     *
+     * The pen and level of detail rules are the same of Wire::paint(), but
+     * all lines are drawn with a single call. The wire ports are drawn
+     * afterwards, as the wire items do not paint themselves.
+     */
+    void WireLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                          QWidget *widget)
+    {
+        const QVector<Wire*> visibleWires = wires(option->exposedRect);
+
+        QVector<QLineF> lines;
+        QVector<Wire*> drawnWires;
+        lines.reserve(visibleWires.size());
+        drawnWires.reserve(visibleWires.size());
+        foreach(Wire *wire, visibleWires) {
+            if(wire->isVisible() && !wire->isSelected()) {
+                lines << QLineF(wire->port1()->scenePos(), wire->port2()->scenePos());
+                drawnWires << wire;
+            }
+        }
+
+        if(lines.isEmpty()) {
+            return;
+        }
+
+        Settings *settings = Settings::instance();
+        const QColor color = settings->currentValue("gui/lineColor").value<QColor>();
+
+        // When zoomed out, use a cosmetic aliased pen which is much cheaper to
+        // rasterize than a wide antialiased one
+        const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+        const bool outline = lod < Caneda::LodOutlineThreshold;
+
+        painter->save();
+        if(outline) {
+            painter->setPen(QPen(color, 0));
+            painter->setRenderHint(QPainter::Antialiasing, false);
+        }
+        else {
+            painter->setPen(QPen(color, settings->currentValue("gui/lineWidth").toInt()));
+            painter->setRenderHint(QPainter::Antialiasing, true);
+        }
+        painter->setBrush(Qt::NoBrush);
+
+        painter->drawLines(lines);
+
+        // Port markers are not legible when zoomed out, so skip them
+        if(lod >= Caneda::LodDetailsThreshold) {
+            foreach(Wire *wire, drawnWires) {
+                foreach(Port *port, wire->ports()) {
+                    port->paint(painter, port->scenePos());
+                }
+            }
+        }
+
+        painter->restore();
+    }
+
+    //! \brief Grows the layer bounding rect to contain \a rect.
+    void WireLayer::extendBoundingRect(const QRectF &rect)
+    {
+        if(!m_boundingRect.contains(rect)) {
+            prepareGeometryChange();
+            m_boundingRect |= rect;
+        }
+    }
+
+    /*!
+     * \brief Recomputes the layer bounding rect after a wire left \a removedRect.
+     *
+     * The union of all wires is only recomputed when \a removedRect was on
+     * the border of the layer, as otherwise the bounding rect can not shrink.
+     */
+    void WireLayer::shrinkBoundingRect(const QRectF &removedRect)
+    {
+        if(removedRect.left() > m_boundingRect.left() &&
+                removedRect.top() > m_boundingRect.top() &&
+                removedRect.right() < m_boundingRect.right() &&
+                removedRect.bottom() < m_boundingRect.bottom()) {
+            return;
+        }
+
+        QRectF rect;
+        for(QHash<Wire*, Entry>::const_iterator it = m_entries.constBegin();
+                it != m_entries.constEnd(); ++it) {
+            rect |= it.value().sceneRect;
+        }
+
+        if(rect != m_boundingRect) {
+            prepareGeometryChange();
+            m_boundingRect = rect;
+        }
+    }
+
+    //! \brief Returns the range of cells covered by \a rect.
+    QRect WireLayer::cellRange(const QRectF &rect) const
+    {
+        return QRect(QPoint(qFloor(rect.left() / CellSize), qFloor(rect.top() / CellSize)),
+                     QPoint(qFloor(rect.right() / CellSize), qFloor(rect.bottom() / CellSize)));
+    }
+
+    //! \brief Adds a wire to a range of cells.
+    void WireLayer::addToCells(Wire *wire, const QRect &cells)
+    {
+        for(int x = cells.left(); x <= cells.right(); ++x) {
+            for(int y = cells.top(); y <= cells.bottom(); ++y) {
+                m_cells[Cell(x, y)] << wire;
+            }
+        }
+    }
+
+    //! \brief Removes a wire from a range of cells.
+    void WireLayer::removeFromCells(Wire *wire, const QRect &cells)
+    {
+        for(int x = cells.left(); x <= cells.right(); ++x) {
+            for(int y = cells.top(); y <= cells.bottom(); ++y) {
+                QHash<Cell, QVector<Wire*> >::iterator cell = m_cells.find(Cell(x, y));
+                if(cell == m_cells.end()) {
+                    continue;
+                }
+
+                QVector<Wire*> &cellWires = cell.value();
+                int index = cellWires.indexOf(wire);
+                if(index >= 0) {
+                    cellWires[index] = cellWires.last();
+                    cellWires.removeLast();
+                }
+                if(cellWires.isEmpty()) {
+                    m_cells.erase(cell);
+                }
+            }
+        }
+    }
+
+} // namespace Caneda
@@ -0,0 +1,108 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef WIRE_LAYER_H
+#define WIRE_LAYER_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPair>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+
+namespace Caneda
+{
+    // Forward declarations
+    class Wire;
+
+    /*!
+     * \brief This class draws all the unselected wires of a scene at once.
+     *
+     * Drawing each wire as an independent item has a high per item overhead
+     * (painter state, settings lookups, etc), which dominates the repaint
+     * time of wire heavy schematics. Instead, the unselected wires of a
+     * GraphicsScene are drawn together by this item, with a single
+     * QPainter::drawLines() call. Wire items are kept in the scene for
+     * selection and editing, and only paint themselves while selected.
+     *
+     * The layer is a scene item with the same z value as the wires
+     * (Caneda::WireZValue), added to the scene before any wire. In this way,
+     * unselected and selected wires are both drawn above the components and
+     * paintings, and selected wires above the unselected ones. The layer
+     * bounding rect is the union of its wires, and its shape is empty, so it
+     * is never found by the scene item lookups.
+     *
+     * To draw only the wires in the exposed area, the wires are kept in a
+     * uniform grid of cells (a simple spatial index of their segments),
+     * updated by the scene whenever a wire is added, removed or changes its
+     * geometry.
+     *
+     * \sa GraphicsScene::updateWire(), Wire
+     */
+    class WireLayer : public QGraphicsItem
+    {
+    public:
+        explicit WireLayer(QGraphicsItem *parent = nullptr);
+
+        void insertWire(Wire *wire);
+        void removeWire(Wire *wire);
+        void updateWire(Wire *wire);
+
+        QVector<Wire*> wires(const QRectF &rect) const;
+
+        QRectF boundingRect() const override;
+        QPainterPath shape() const override;
+        void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                   QWidget *widget = nullptr) override;
+
+    private:
+        //! Index entry of a wire.
+        struct Entry
+        {
+            //! Scene bounding rect of the wire when last indexed.
+            QRectF sceneRect;
+            //! Range of cells covered by sceneRect.
+            QRect cells;
+            //! Last query that visited this wire, to report each wire once.
+            mutable int stamp;
+        };
+
+        typedef QPair<int, int> Cell;
+
+        void extendBoundingRect(const QRectF &rect);
+        void shrinkBoundingRect(const QRectF &removedRect);
+
+        QRect cellRange(const QRectF &rect) const;
+        void addToCells(Wire *wire, const QRect &cells);
+        void removeFromCells(Wire *wire, const QRect &cells);
+
+        QHash<Wire*, Entry> m_entries;
+        QHash<Cell, QVector<Wire*> > m_cells;
+
+        //! Union of the scene rects of all wires.
+        QRectF m_boundingRect;
+
+        //! Current query stamp.
+        mutable int m_stamp;
+    };
+
+} // namespace Caneda
+
+#endif //WIRE_LAYER_H
@@ -35,6 +35,52 @@
 
 namespace Caneda
 {
+    /*!
+     * \brief Parses a comma separated list of numbers.
+     *
+     * The numbers are tokenized and converted in place, without creating any
+     * temporary strings, as this is done for every item of a loaded file.
+     *
+     * \param text Attribute value to parse.
+     * \param values Array where the parsed numbers are returned.
+     * \param count Number of values expected in \a text.
+     * \param skipEmptyParts If true, empty entries (as in "1,,2") are ignored.
+     * \return True if exactly \a count valid numbers were found.
+     */
+    static bool parseRealList(const QStringRef &text, qreal *values, int count,
+                              bool skipEmptyParts)
+    {
+        int found = 0;
+        int start = 0;
+
+        forever {
+            int end = text.indexOf(QLatin1Char(','), start);
+            if(end < 0) {
+                end = text.size();
+            }
+
+            QStringRef token = text.mid(start, end - start);
+            if(!skipEmptyParts || !token.isEmpty()) {
+                if(found == count) {
+                    return false;
+                }
+
+                bool ok;
+                values[found++] = token.toDouble(&ok);
+                if(!ok) {
+                    return false;
+                }
+            }
+
+            if(end == text.size()) {
+                break;
+            }
+            start = end + 1;
+        }
+
+        return found == count;
+    }
+
     /*************************************************************************
      *                                XmlReader                              *
      *************************************************************************/
@@ -82,7 +128,7 @@ namespace Caneda
     qreal XmlReader::readDoubleAttribute(QString tag)
     {
         bool ok;
-        qreal val = attributes().value(tag).toString().toDouble(&ok);
+        qreal val = attributes().value(tag).toDouble(&ok);
         Q_ASSERT(ok);
         return val;
     }
@@ -94,8 +140,8 @@ namespace Caneda
         bool ok1, ok2;
         QXmlStreamAttributes attribs = attributes();
 
-        qreal x = attribs.value("x").toString().toDouble(&ok1);
-        qreal y = attribs.value("y").toString().toDouble(&ok2);
+        qreal x = attribs.value("x").toDouble(&ok1);
+        qreal y = attribs.value("y").toDouble(&ok2);
 
         if(!ok1 || !ok2) {
             raiseError(QObject::tr("String to double conversion failed"));
@@ -110,13 +156,13 @@ namespace Caneda
     QPointF XmlReader::readPointAttribute(QString tag)
     {
         Q_ASSERT(isStartElement());
-        QString pointStr = attributes().value(tag).toString();
-        int commaPos = pointStr.indexOf(',');
+        QXmlStreamAttributes attribs = attributes();
+        QStringRef pointStr = attribs.value(tag);
+        int commaPos = pointStr.indexOf(QLatin1Char(','));
 
         QPointF point;
-        bool ok;
-        point.setX(pointStr.left(commaPos).toDouble(&ok));
-        point.setY(pointStr.mid(commaPos+1).toDouble(&ok));
+        point.setX(pointStr.left(commaPos).toDouble());
+        point.setY(pointStr.mid(commaPos+1).toDouble());
 
         return point;
     }
@@ -124,23 +170,12 @@ namespace Caneda
     QLineF XmlReader::readLineAttribute(QString tag)
     {
         Q_ASSERT(isStartElement());
-        QString errorString = QObject::tr("Invalid line attribute");
-        QStringList lineCoordsStr = attributes().value(tag).toString().
-            split(",",Qt::SkipEmptyParts);
-
-        if(lineCoordsStr.size() != 4) {
-            raiseError(errorString);
-            return QLineF();
-        }
+        QXmlStreamAttributes attribs = attributes();
 
         qreal lineCoords[4];
-        bool ok;
-        for(int i=0; i < 4; ++i) {
-            lineCoords[i] = lineCoordsStr.at(i).trimmed().toDouble(&ok);
-            if(!ok) {
-                raiseError(errorString);
-                return QLineF();
-            }
+        if(!parseRealList(attribs.value(tag), lineCoords, 4, true)) {
+            raiseError(QObject::tr("Invalid line attribute"));
+            return QLineF();
         }
 
         return QLineF(lineCoords[0], lineCoords[1], lineCoords[2], lineCoords[3]);
@@ -149,23 +184,12 @@ namespace Caneda
     QRectF XmlReader::readRectAttribute(QLatin1String tag)
     {
         Q_ASSERT(isStartElement());
-        QString errorString = QObject::tr("Invalid rect attribute");
-        QStringList rectCoordsStr = attributes().value(tag).toString().
-            split(",",Qt::SkipEmptyParts);
-
-        if(rectCoordsStr.size() != 4) {
-            raiseError(errorString);
-            return QRectF();
-        }
+        QXmlStreamAttributes attribs = attributes();
 
         qreal rectCoords[4];
-        bool ok;
-        for(int i=0; i < 4; ++i) {
-            rectCoords[i] = rectCoordsStr.at(i).trimmed().toDouble(&ok);
-            if(!ok) {
-                raiseError(errorString);
-                return QRectF();
-            }
+        if(!parseRealList(attribs.value(tag), rectCoords, 4, true)) {
+            raiseError(QObject::tr("Invalid rect attribute"));
+            return QRectF();
         }
 
         return QRectF(rectCoords[0], rectCoords[1], rectCoords[2], rectCoords[3]);
@@ -174,23 +198,11 @@ namespace Caneda
     QTransform XmlReader::readTransformAttribute(QString tag)
     {
         Q_ASSERT(isStartElement());
-        QString errorString = QObject::tr("Invalid transform matrix");
-        QStringList eleStr = attributes().value(tag).toString().split(',');
-
-        if(eleStr.size() != 6) {
-            raiseError(errorString);
-            return QTransform();
-        }
+        QXmlStreamAttributes attribs = attributes();
 
-        bool ok, finalOk = true;
         qreal ele[6];
-        for(int i = 0; i < 6; ++i) {
-            ele[i] = eleStr[i].toDouble(&ok);
-            finalOk = finalOk && ok;
-        }
-
-        if(!finalOk) {
-            raiseError(errorString);
+        if(!parseRealList(attribs.value(tag), ele, 6, false)) {
+            raiseError(QObject::tr("Invalid transform matrix"));
             return QTransform();
         }
 
@@ -199,6 +211,7 @@ namespace Caneda
              ele[1], ele[3], ele[5],
              0,      0,          1);
 
+        bool ok;
         QTransform retVal = transformMatrix.inverted(&ok);
 
         if(!ok) {
@@ -215,8 +228,8 @@ namespace Caneda
         bool ok1, ok2;
         QXmlStreamAttributes attribs = attributes();
 
-        int w = attribs.value("width").toString().toInt(&ok1);
-        int h = attribs.value("height").toString().toInt(&ok2);
+        int w = attribs.value("width").toInt(&ok1);
+        int h = attribs.value("height").toInt(&ok2);
 
         if(!ok1 || !ok2) {
             raiseError(QObject::tr("String to int conversion failed"));
@@ -235,10 +248,10 @@ namespace Caneda
         bool ok1, ok2, ok3, ok4;
         QXmlStreamAttributes attribs = attributes();
 
-        qreal x = attribs.value("x").toString().toDouble(&ok1);
-        qreal y = attribs.value("y").toString().toDouble(&ok2);
-        qreal w = attribs.value("width").toString().toDouble(&ok3);
-        qreal h = attribs.value("height").toString().toDouble(&ok4);
+        qreal x = attribs.value("x").toDouble(&ok1);
+        qreal y = attribs.value("y").toDouble(&ok2);
+        qreal w = attribs.value("width").toDouble(&ok3);
+        qreal h = attribs.value("height").toDouble(&ok4);
 
         if(!ok1 || !ok2 || !ok3 || !ok4) {
             raiseError(QObject::tr("String to double conversion failed"));